@@ -1,9 +1,23 @@
 #pragma once
 
+#include "Midi/BleMidiCodec.h"
+#include "Midi/CaptureMidiSink.h"
 #include "Midi/CompositeMidiSink.h"
+#include "Midi/ControllerCoalescer.h"
 #include "Midi/DebugMidiSink.h"
+#include "Midi/MidiBlockScheduler.h"
+#include "Midi/MidiClock.h"
+#include "Midi/MidiDispatcher.h"
+#include "Midi/MidiEvent.h"
+#include "Midi/MidiEventQueue.h"
 #include "Midi/MidiMessageProcessor.h"
 #include "Midi/MidiMessages.h"
 #include "Midi/MidiNote.h"
+#include "Midi/MidiRouter.h"
 #include "Midi/MidiSink.h"
-#include "Midi/MidiSource.h"
\ No newline at end of file
+#include "Midi/MidiSource.h"
+#include "Midi/MidiStreamEncoder.h"
+#include "Midi/MidiStreamParser.h"
+#include "Midi/StandardMidiFile.h"
+#include "Midi/StaticMidiMessageProcessor.h"
+#include "Midi/SysEx.h"
\ No newline at end of file
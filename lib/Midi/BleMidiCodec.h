@@ -0,0 +1,429 @@
+#pragma once
+#include <stdint.h>
+#include <cstddef>
+#include <string.h>
+#include "MidiEvent.h"
+#include "SysEx.h"
+
+namespace Midi
+{
+
+  /// @brief Decodes BLE-MIDI characteristic notifications.
+  /// A packet is a header byte (timestamp bits 12..7) followed by messages, each preceded by a
+  /// timestamp byte (bits 6..0); running status and several messages per packet are supported,
+  /// and SysEx may continue over following packets.
+  ///
+  /// The 13 bit packet timestamps are unwrapped into the sender's millisecond clock and mapped onto engine
+  /// sample time (see MidiEvent): the first packet is placed at the sample time it arrived at, and whenever
+  /// a packet would land later than its arrival the mapping moves back to it, so the mapping follows the
+  /// fastest transfer seen and events keep the sender's spacing. Output goes to the same handler
+  /// as MidiStreamParser: onEvents(const MidiEvent *events, size_t count) and onSysEx(const SysExChunk &chunk),
+  /// with SysEx as spans into the packet.
+  template <size_t BatchLength = 32>
+  class BleMidiDecoder
+  {
+  private:
+    MidiEvent _batch[BatchLength];
+    size_t _batchCount;
+    float _sampleRate;
+    uint32_t _time;
+    uint32_t _sampleTime;
+    uint32_t _anchorTime;
+    uint32_t _anchorSample;
+    uint32_t _arrival;
+    bool _anchored;
+    uint8_t _status;
+    bool _inSysEx;
+    bool _sysExFirst;
+    uint32_t _malformed;
+
+    template <class Handler>
+    inline void flush(Handler &handler)
+    {
+      if (_batchCount > 0)
+      {
+        handler.onEvents(_batch, _batchCount);
+        _batchCount = 0;
+      }
+    }
+
+    template <class Handler>
+    inline void emit(Handler &handler, uint8_t status, uint8_t data1, uint8_t data2, uint8_t length)
+    {
+      MidiEvent &event = _batch[_batchCount++];
+      event.timestamp = _sampleTime;
+      event.status = status;
+      event.data1 = data1;
+      event.data2 = data2;
+      event.length = length;
+      if (_batchCount == BatchLength)
+      {
+        flush(handler);
+      }
+    }
+
+    template <class Handler>
+    inline void sysEx(Handler &handler, const uint8_t *data, size_t length, bool last, bool aborted)
+    {
+      if (length == 0 && !last)
+      {
+        return;
+      }
+      flush(handler);
+      SysExChunk chunk;
+      chunk.data = data;
+      chunk.length = length;
+      chunk.timestamp = _sampleTime;
+      chunk.first = _sysExFirst;
+      chunk.last = last;
+      chunk.aborted = aborted;
+      _sysExFirst = false;
+      handler.onSysEx(chunk);
+    }
+
+    /// @brief moves the clock forward to the 13 bit timestamp, which is never behind the clock;
+    /// the first timestamp of a packet checks the mapping to sample time against the packet's arrival
+    inline void setTime(uint8_t high, uint8_t low, bool first)
+    {
+      const uint32_t stamp = ((uint32_t)(high & 0x3F) << 7) | (low & 0x7F);
+      _time += (stamp - _time) & 0x1FFF;
+      _sampleTime = _anchorSample + (uint32_t)((double)(_time - _anchorTime) * (double)_sampleRate / 1000.0);
+      if (first && (!_anchored || MidiEvent::before(_arrival, _sampleTime)))
+      {
+        _anchorTime = _time;
+        _anchorSample = _arrival;
+        _sampleTime = _arrival;
+        _anchored = true;
+      }
+    }
+
+    /*
+     * reads the data bytes of status at packet[i], returns the index after the message
+     */
+    template <class Handler>
+    size_t message(Handler &handler, uint8_t status, const uint8_t *packet, size_t i, size_t length)
+    {
+      const uint8_t count = MidiEvent::dataLength(status);
+      if (i + count > length || (count > 0 && (packet[i] & 0x80)) || (count > 1 && (packet[i + 1] & 0x80)))
+      {
+        _malformed++;
+        _status = 0;
+        return i;
+      }
+      emit(handler, status, count > 0 ? packet[i] : 0, count > 1 ? packet[i + 1] : 0, count);
+      return i + count;
+    }
+
+  public:
+    BleMidiDecoder(float sampleRate) : _sampleRate(sampleRate) { reset(); }
+
+    void reset()
+    {
+      _batchCount = 0;
+      _time = 0;
+      _sampleTime = 0;
+      _anchorTime = 0;
+      _anchorSample = 0;
+      _arrival = 0;
+      _anchored = false;
+      _status = 0;
+      _inSysEx = false;
+      _sysExFirst = false;
+      _malformed = 0;
+    }
+
+    /// @brief decodes one notification, returns false if it is not a BLE-MIDI packet
+    /// @param sampleTime engine sample time the packet arrived at, plus the latency that absorbs the transport's jitter
+    template <class Handler>
+    bool decode(const uint8_t *packet, size_t length, Handler &handler, uint32_t sampleTime)
+    {
+      if (length < 2 || (packet[0] & 0xC0) != 0x80)
+      {
+        _malformed++;
+        return false;
+      }
+      _arrival = sampleTime;
+      uint8_t high = packet[0] & 0x3F;
+      uint8_t lastLow = 0;
+      bool stamped = false;
+      size_t sysExStart = 1;
+      size_t i = 1;
+      while (i < length)
+      {
+        uint8_t b = packet[i];
+        if (_inSysEx && b < 0x80)
+        {
+          i++;
+          continue;
+        }
+
+        if (b & 0x80)
+        {
+          // timestamp byte, the low bits wrapping around carry into the header bits
+          const uint8_t low = b & 0x7F;
+          if (stamped && low < lastLow)
+          {
+            high = (high + 1) & 0x3F;
+          }
+          lastLow = low;
+          setTime(high, low, !stamped);
+          stamped = true;
+          const size_t stampIndex = i;
+          if (++i >= length)
+          {
+            break;
+          }
+          b = packet[i];
+
+          if (_inSysEx)
+          {
+            if (b >= 0xF8)
+            {
+              sysEx(handler, packet + sysExStart, stampIndex - sysExStart, false, false);
+              emit(handler, b, 0, 0, 0);
+              sysExStart = ++i;
+              continue;
+            }
+            // F7 ends the SysEx, any other status aborts it
+            sysEx(handler, packet + sysExStart, stampIndex - sysExStart, true, b != 0xF7);
+            _inSysEx = false;
+            if (b == 0xF7)
+            {
+              i++;
+              continue;
+            }
+          }
+
+          if (b & 0x80)
+          {
+            i++;
+            if (b >= 0xF8)
+            {
+              emit(handler, b, 0, 0, 0);
+            }
+            else if (b == 0xF0)
+            {
+              _inSysEx = true;
+              _sysExFirst = true;
+              _status = 0;
+              sysExStart = i;
+            }
+            else if (b == 0xF7)
+            {
+              _malformed++;
+            }
+            else
+            {
+              _status = b < 0xF0 ? b : 0;
+              i = message(handler, b, packet, i, length);
+            }
+            continue;
+          }
+        }
+
+        // data bytes in running status, with the last timestamp
+        if (_status == 0)
+        {
+          _malformed++;
+          i++;
+          continue;
+        }
+        const size_t next = message(handler, _status, packet, i, length);
+        i = next > i ? next : i + 1;
+      }
+      if (_inSysEx)
+      {
+        sysEx(handler, packet + sysExStart, length - sysExStart, false, false);
+      }
+      flush(handler);
+      return true;
+    }
+
+    /// @brief bytes or messages that did not follow the packet format
+    inline uint32_t malformed() const { return _malformed; }
+  };
+
+  /// @brief Packs events into BLE-MIDI notifications, as many per packet as the negotiated MTU allows.
+  /// Consecutive messages with the same status use running status, and the timestamp byte is left out
+  /// as well when the timestamp does not change. Timestamps are in milliseconds (only the low 13 bits are sent).
+  /// Finished packets go to output.onPacket(const uint8_t *data, size_t length).
+  template <size_t MaxPacketLength = 512>
+  class BleMidiEncoder
+  {
+  public:
+    static const size_t DefaultMtu = 23;
+    /// @brief ATT header of a notification
+    static const size_t AttOverhead = 3;
+
+  private:
+    uint8_t _packet[MaxPacketLength];
+    size_t _length;
+    size_t _capacity;
+    uint8_t _runningStatus;
+    uint8_t _high;
+    uint8_t _lastLow;
+    bool _stamped;
+
+    inline void begin(uint32_t timestamp)
+    {
+      if (_length == 0)
+      {
+        _high = (timestamp >> 7) & 0x3F;
+        _packet[_length++] = 0x80 | _high;
+        _runningStatus = 0;
+        _stamped = false;
+      }
+    }
+
+    /// @brief the timestamp can be expressed relative to the packet header without going backwards
+    inline bool stampFits(uint32_t timestamp) const
+    {
+      if (!_stamped)
+      {
+        return true;
+      }
+      const uint8_t high = (timestamp >> 7) & 0x3F;
+      const uint8_t low = timestamp & 0x7F;
+      return (high == _high && low >= _lastLow) || (high == ((_high + 1) & 0x3F) && low < _lastLow);
+    }
+
+    inline void stamp(uint32_t timestamp)
+    {
+      const uint8_t low = timestamp & 0x7F;
+      if (_stamped && low < _lastLow)
+      {
+        _high = (_high + 1) & 0x3F;
+      }
+      _packet[_length++] = 0x80 | low;
+      _lastLow = low;
+      _stamped = true;
+    }
+
+  public:
+    BleMidiEncoder() : _length(0), _runningStatus(0), _high(0), _lastLow(0), _stamped(false)
+    {
+      setMtu(DefaultMtu);
+    }
+
+    /// @brief the negotiated ATT MTU, packets are at most mtu - 3 bytes
+    void setMtu(size_t mtu)
+    {
+      _capacity = mtu > AttOverhead ? mtu - AttOverhead : 1;
+      if (_capacity > MaxPacketLength)
+      {
+        _capacity = MaxPacketLength;
+      }
+      if (_capacity < 5)
+      {
+        _capacity = 5;
+      }
+    }
+
+    /// @brief appends to the current packet, returns false when the event does not fit and the packet has to be flushed first
+    bool add(const MidiEvent &event, uint32_t timestamp)
+    {
+      const uint8_t status = event.status;
+      const uint8_t count = event.length > 2 ? 2 : event.length;
+      const bool packetOpen = _length > 0;
+      if (packetOpen && !stampFits(timestamp))
+      {
+        return false;
+      }
+      const bool sameTime = _stamped && (timestamp & 0x7F) == _lastLow && ((timestamp >> 7) & 0x3F) == _high;
+      const bool running = status < 0xF0 && status == _runningStatus;
+      const size_t needed = (packetOpen ? 0 : 1) + (running && sameTime ? 0 : 1) + (running ? 0 : 1) + count;
+      if ((packetOpen ? _length : 0) + needed > _capacity)
+      {
+        return false;
+      }
+      begin(timestamp);
+      if (!(running && sameTime))
+      {
+        stamp(timestamp);
+      }
+      if (!running)
+      {
+        _packet[_length++] = status;
+        if (status < 0xF8)
+        {
+          _runningStatus = status < 0xF0 ? status : 0;
+        }
+      }
+      if (count > 0)
+      {
+        _packet[_length++] = event.data1;
+      }
+      if (count > 1)
+      {
+        _packet[_length++] = event.data2;
+      }
+      return true;
+    }
+
+    /// @brief adds the event, sending the current packet first if it is full
+    template <class Output>
+    void write(const MidiEvent &event, uint32_t timestamp, Output &output)
+    {
+      if (!add(event, timestamp))
+      {
+        flush(output);
+        add(event, timestamp);
+      }
+    }
+
+    /// @brief a complete SysEx, payload without F0 and F7, continued over as many packets as needed
+    template <class Output>
+    void writeSysEx(const uint8_t *data, size_t length, uint32_t timestamp, Output &output)
+    {
+      if (_length > 0 && (!stampFits(timestamp) || _length + 2 > _capacity))
+      {
+        flush(output);
+      }
+      begin(timestamp);
+      stamp(timestamp);
+      _packet[_length++] = 0xF0;
+      size_t written = 0;
+      while (written < length)
+      {
+        if (_length == _capacity)
+        {
+          flush(output);
+          // continuation packets carry the header only, no timestamp in front of the data
+          begin(timestamp);
+        }
+        const size_t room = _capacity - _length;
+        const size_t part = length - written < room ? length - written : room;
+        memcpy(_packet + _length, data + written, part);
+        _length += part;
+        written += part;
+      }
+      if (_length + 2 > _capacity)
+      {
+        flush(output);
+        begin(timestamp);
+      }
+      stamp(timestamp);
+      _packet[_length++] = 0xF7;
+      _runningStatus = 0;
+    }
+
+    /// @brief sends the current packet, if any
+    template <class Output>
+    void flush(Output &output)
+    {
+      if (_length > 1)
+      {
+        output.onPacket(_packet, _length);
+      }
+      _length = 0;
+      _runningStatus = 0;
+      _stamped = false;
+    }
+
+    inline const uint8_t *data() const { return _packet; }
+    inline size_t length() const { return _length; }
+    inline size_t capacity() const { return _capacity; }
+    inline bool empty() const { return _length == 0; }
+  };
+
+}
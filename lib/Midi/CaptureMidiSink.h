@@ -0,0 +1,274 @@
+#pragma once
+#include <stdint.h>
+#include <cstddef>
+#include <stdio.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include "MidiEvent.h"
+#include "MidiEventQueue.h"
+#include "MidiSink.h"
+
+namespace Midi
+{
+
+  /// @brief Records every event sent to it for later replay.
+  /// send() stamps the event with the capture clock (microseconds) and pushes it into a lock-free
+  /// MidiEventQueue; it never blocks and never touches a file. A CaptureRecorder drains the queue
+  /// on its own thread. Events that do not fit are counted in overflows(). SysEx is not captured.
+  template <size_t Capacity = 1024>
+  class CaptureMidiSink : public MidiSink
+  {
+  public:
+    typedef uint32_t (*Clock)();
+
+    static uint32_t steadyMicros()
+    {
+      return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+  private:
+    MidiEventQueue<Capacity> _queue;
+    Clock _clock;
+    // toggled by the transport thread while the audio thread sends
+    std::atomic<bool> _isConnected;
+
+  public:
+    CaptureMidiSink(Clock clock = steadyMicros) : _clock(clock), _isConnected(false) {}
+
+    virtual void send(const MidiEvent &event) override
+    {
+      if (_isConnected.load(std::memory_order_relaxed))
+      {
+        MidiEvent captured = event;
+        captured.timestamp = _clock();
+        _queue.push(captured);
+      }
+    }
+    virtual void start() override { _isConnected = true; }
+    virtual void stop() override { _isConnected = false; }
+    virtual bool isConnected() override { return _isConnected; }
+
+    inline size_t drain(MidiEvent *events, size_t maxEvents) { return _queue.drain(events, maxEvents); }
+    inline uint32_t overflows() const { return _queue.overflows(); }
+  };
+
+  /// @brief Compact capture log: the magic "MCAP", a version byte, then 8 bytes per event
+  /// (timestamp in microseconds, little endian, status, data1, data2, length)
+  class BinaryCaptureWriter
+  {
+  private:
+    FILE *_file;
+
+  public:
+    BinaryCaptureWriter() : _file(nullptr) {}
+    ~BinaryCaptureWriter() { close(); }
+
+    bool open(const char *path)
+    {
+      close();
+      _file = fopen(path, "wb");
+      if (_file == nullptr)
+      {
+        return false;
+      }
+      const uint8_t header[5] = {'M', 'C', 'A', 'P', 1};
+      fwrite(header, 1, sizeof(header), _file);
+      return true;
+    }
+
+    void write(const MidiEvent *events, size_t count)
+    {
+      uint8_t record[8];
+      for (size_t i = 0; i < count; i++)
+      {
+        const MidiEvent &event = events[i];
+        record[0] = (uint8_t)event.timestamp;
+        record[1] = (uint8_t)(event.timestamp >> 8);
+        record[2] = (uint8_t)(event.timestamp >> 16);
+        record[3] = (uint8_t)(event.timestamp >> 24);
+        record[4] = event.status;
+        record[5] = event.data1;
+        record[6] = event.data2;
+        record[7] = event.length;
+        fwrite(record, 1, sizeof(record), _file);
+      }
+    }
+
+    void close()
+    {
+      if (_file != nullptr)
+      {
+        fclose(_file);
+        _file = nullptr;
+      }
+    }
+  };
+
+  /// @brief Writes the capture as a format 0 Standard MIDI File with 0.1 ms ticks
+  /// (120 bpm, 5000 ticks per quarter note), the first event starts at tick 0.
+  /// Only channel messages are written: realtime and system common bytes are not valid track events
+  /// (0xFF would start a meta event), they are kept by BinaryCaptureWriter.
+  class SmfCaptureWriter
+  {
+  private:
+    static const uint16_t Division = 5000;
+    static const uint32_t MicrosPerTick = 100;
+
+    FILE *_file;
+    long _trackStart;
+    uint32_t _trackLength;
+    uint32_t _lastTimestamp;
+    bool _started;
+
+    void put(const uint8_t *data, size_t length)
+    {
+      fwrite(data, 1, length, _file);
+      _trackLength += (uint32_t)length;
+    }
+
+    void putVariable(uint32_t value)
+    {
+      uint8_t bytes[5];
+      size_t count = 0;
+      bytes[4] = value & 0x7F;
+      count++;
+      while ((value >>= 7) != 0 && count < 5)
+      {
+        bytes[4 - count] = (value & 0x7F) | 0x80;
+        count++;
+      }
+      put(bytes + 5 - count, count);
+    }
+
+    static void put32(uint8_t *p, uint32_t value)
+    {
+      p[0] = (uint8_t)(value >> 24);
+      p[1] = (uint8_t)(value >> 16);
+      p[2] = (uint8_t)(value >> 8);
+      p[3] = (uint8_t)value;
+    }
+
+  public:
+    SmfCaptureWriter() : _file(nullptr), _trackStart(0), _trackLength(0), _lastTimestamp(0), _started(false) {}
+    ~SmfCaptureWriter() { close(); }
+
+    bool open(const char *path)
+    {
+      close();
+      _file = fopen(path, "wb");
+      if (_file == nullptr)
+      {
+        return false;
+      }
+      const uint8_t header[14] = {'M', 'T', 'h', 'd', 0, 0, 0, 6, 0, 0, 0, 1, (uint8_t)(Division >> 8), (uint8_t)Division};
+      fwrite(header, 1, sizeof(header), _file);
+      const uint8_t track[8] = {'M', 'T', 'r', 'k', 0, 0, 0, 0};
+      _trackStart = ftell(_file);
+      fwrite(track, 1, sizeof(track), _file);
+      _trackLength = 0;
+      _started = false;
+      const uint8_t tempo[7] = {0x00, 0xFF, 0x51, 0x03, 0x07, 0xA1, 0x20};
+      put(tempo, sizeof(tempo));
+      return true;
+    }
+
+    void write(const MidiEvent *events, size_t count)
+    {
+      for (size_t i = 0; i < count; i++)
+      {
+        const MidiEvent &event = events[i];
+        if (!event.isChannelMessage())
+        {
+          // the time up to the next written event still counts in its delta
+          continue;
+        }
+        if (!_started)
+        {
+          _lastTimestamp = event.timestamp;
+          _started = true;
+        }
+        // the remainder carries over to the next event, so rounding does not drift over a long session
+        const uint32_t elapsed = event.timestamp - _lastTimestamp;
+        const uint32_t delta = elapsed / MicrosPerTick;
+        _lastTimestamp += delta * MicrosPerTick;
+        putVariable(delta);
+        const uint8_t bytes[3] = {event.status, event.data1, event.data2};
+        put(bytes, 1 + (event.length > 2 ? 2 : event.length));
+      }
+    }
+
+    void close()
+    {
+      if (_file == nullptr)
+      {
+        return;
+      }
+      const uint8_t end[4] = {0x00, 0xFF, 0x2F, 0x00};
+      put(end, sizeof(end));
+      uint8_t length[4];
+      put32(length, _trackLength);
+      fseek(_file, _trackStart + 4, SEEK_SET);
+      fwrite(length, 1, sizeof(length), _file);
+      fclose(_file);
+      _file = nullptr;
+    }
+  };
+
+  /// @brief Background thread moving captured events from a CaptureMidiSink to a writer
+  /// (BinaryCaptureWriter, SmfCaptureWriter or anything with write(const MidiEvent *events, size_t count)).
+  template <class Sink, class Writer>
+  class CaptureRecorder
+  {
+  private:
+    static const size_t ChunkLength = 64;
+
+    Sink &_sink;
+    Writer &_writer;
+    std::atomic<bool> _running;
+    std::thread _thread;
+    uint32_t _intervalMs;
+
+    void flush()
+    {
+      MidiEvent events[ChunkLength];
+      size_t count;
+      while ((count = _sink.drain(events, ChunkLength)) > 0)
+      {
+        _writer.write(events, count);
+      }
+    }
+
+    void run()
+    {
+      while (_running.load(std::memory_order_relaxed))
+      {
+        flush();
+        std::this_thread::sleep_for(std::chrono::milliseconds(_intervalMs));
+      }
+      flush();
+    }
+
+  public:
+    CaptureRecorder(Sink &sink, Writer &writer, uint32_t intervalMs = 5) : _sink(sink), _writer(writer), _running(false), _intervalMs(intervalMs) {}
+    ~CaptureRecorder() { stop(); }
+
+    void start()
+    {
+      if (!_running.exchange(true))
+      {
+        _thread = std::thread(&CaptureRecorder::run, this);
+      }
+    }
+
+    /// @brief stops the thread after writing everything captured so far, the writer can be closed afterwards
+    void stop()
+    {
+      if (_running.exchange(false))
+      {
+        _thread.join();
+      }
+    }
+  };
+
+}
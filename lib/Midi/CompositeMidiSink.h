@@ -17,13 +17,18 @@ namespace Midi
 
   public:
     CompositeMidiSink(MidiSink &a, MidiSink &b) : _a(a), _b(b) {}
-    virtual void send(Midi::MidiMessage message)
+    virtual void send(const MidiEvent &event)
     {
       {
-        _a.send(message);
-        _b.send(message);
+        _a.send(event);
+        _b.send(event);
       }
     }
+    virtual void sendSysEx(const SysExChunk &chunk)
+    {
+      _a.sendSysEx(chunk);
+      _b.sendSysEx(chunk);
+    }
     virtual void start()
     {
       _a.start();
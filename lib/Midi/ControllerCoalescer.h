@@ -0,0 +1,139 @@
+#pragma once
+#include <stdint.h>
+#include <cstddef>
+#include "MidiEvent.h"
+
+namespace Midi
+{
+
+  /// @brief Optional stage between the input queue and the processor that thins out controller floods.
+  /// Within a batch only the latest Control Change per (channel, controller), Pitch Bend and Channel Pressure
+  /// per channel and Polyphonic Key Pressure per (channel, note) is kept. Events that depend on the order of
+  /// the controllers around them are barriers: notes, program changes, channel mode messages (CC 120-127) and
+  /// RPN/NRPN selection and data entry (CC 6, 38, 96-101) are never dropped, and a controller is only replaced
+  /// by a later value of the same key on the same channel without such a barrier in between. So a sustain pedal
+  /// release after a note off still follows the note off. Everything kept stays in its original order.
+  ///
+  ///   size_t count = queue.drain(events, MaxEvents);
+  ///   count = coalescer.coalesce(events, count);
+  ///   processor.process(events, count);
+  class ControllerCoalescer
+  {
+  private:
+    static const size_t PitchBendKeys = 2048;
+    static const size_t ChannelPressureKeys = PitchBendKeys + 16;
+    static const size_t KeyPressureKeys = ChannelPressureKeys + 16;
+    static const size_t KeyCount = KeyPressureKeys + 2048;
+
+    /// @brief generation of every key when it was last kept, a key is a duplicate while this matches its channel's generation
+    uint32_t _seen[KeyCount];
+    uint32_t _barrier[Constants::MaxChannels];
+    uint32_t _generation;
+    uint32_t _dropped;
+
+    static inline bool isOrderedController(uint8_t controller)
+    {
+      return controller >= 120 || controller == 6 || controller == 38 || (controller >= 96 && controller <= 101);
+    }
+
+    /// @brief the key of a coalescable event, -1 for barriers and everything else
+    static inline int key(const MidiEvent &event)
+    {
+      const uint8_t channel = event.channel();
+      switch (event.type())
+      {
+      case MidiMessageStatus::ControlChange:
+        return isOrderedController(event.data1) ? -1 : channel * 128 + event.data1;
+      case MidiMessageStatus::PitchBendChange:
+        return PitchBendKeys + channel;
+      case MidiMessageStatus::ChannelPressure:
+        return ChannelPressureKeys + channel;
+      case MidiMessageStatus::PolyphonicKeyPressure:
+        return KeyPressureKeys + channel * 128 + event.data1;
+      default:
+        return -1;
+      }
+    }
+
+  public:
+    ControllerCoalescer() : _generation(0), _dropped(0)
+    {
+      reset();
+    }
+
+    void reset()
+    {
+      for (size_t i = 0; i < KeyCount; i++)
+      {
+        _seen[i] = 0;
+      }
+      for (size_t c = 0; c < Constants::MaxChannels; c++)
+      {
+        _barrier[c] = 0;
+      }
+      _generation = 0;
+    }
+
+    /// @brief removes superseded controller values in place, returns the new number of events
+    size_t coalesce(MidiEvent *events, size_t count)
+    {
+      if (count < 2)
+      {
+        return count;
+      }
+      // a batch bumps the generation at most count + 1 times, start over well before it wraps
+      if (_generation > 0xFFFF0000u - count)
+      {
+        reset();
+      }
+      _generation++;
+      for (size_t c = 0; c < Constants::MaxChannels; c++)
+      {
+        _barrier[c] = _generation;
+      }
+
+      // walk backwards so the latest value of a key is met first, kept events are packed towards the end
+      size_t write = count;
+      for (size_t i = count; i-- > 0;)
+      {
+        const MidiEvent &event = events[i];
+        if (event.isChannelMessage())
+        {
+          const uint8_t channel = event.channel();
+          const int k = key(event);
+          if (k < 0)
+          {
+            _barrier[channel] = ++_generation;
+          }
+          else if (_seen[k] == _barrier[channel])
+          {
+            _dropped++;
+            continue;
+          }
+          else
+          {
+            _seen[k] = _barrier[channel];
+          }
+        }
+        events[--write] = events[i];
+      }
+
+      const size_t kept = count - write;
+      for (size_t i = 0; i < kept && write > 0; i++)
+      {
+        events[i] = events[write + i];
+      }
+      return kept;
+    }
+
+    /// @brief events removed since construction or the last takeDropped()
+    inline uint32_t dropped() const { return _dropped; }
+    inline uint32_t takeDropped()
+    {
+      const uint32_t dropped = _dropped;
+      _dropped = 0;
+      return dropped;
+    }
+  };
+
+}
@@ -15,15 +15,15 @@ namespace Midi
 
   public:
     DebugMidiSink() : _isConnected(false) {}
-    virtual void send(Midi::MidiMessage message) override
+    virtual void send(const MidiEvent &event) override
     {
       if (_isConnected)
       {
-        uint32_t buffer;
-        size_t length = message.length();
-        message.getData((uint8_t *)&buffer, 0, length);
-        buffer = buffer >> 8;
+        uint32_t buffer = ((uint32_t)event.status << 16) | ((uint32_t)event.data1 << 8) | event.data2;
+        size_t length = event.length;
         // ESP_LOGD(MidiDebugTAG, "%01u 0x%06X", length, buffer);
+        (void)buffer;
+        (void)length;
       }
     }
     virtual void start() override { _isConnected = true; }
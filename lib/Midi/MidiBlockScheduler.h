@@ -0,0 +1,113 @@
+#pragma once
+#include <stdint.h>
+#include <cstddef>
+#include "MidiEvent.h"
+
+namespace Midi
+{
+
+  /// @brief Splits every audio block at the timestamps of its events so notes and controllers
+  /// take effect on the sample they were scheduled for instead of the next block boundary.
+  ///
+  /// Event timestamps are engine sample time (see MidiEvent). The scheduler counts the sample time of
+  /// the block it renders next, blockStart(), and rebases every event onto it when the block is rendered;
+  /// events that are already due play at the start of the block, later ones wait. Events are applied in
+  /// timestamp order, events with equal timestamps in the order they were scheduled.
+  ///
+  /// The renderer provides
+  ///   void render(size_t offset, size_t length);                  render samples offset .. offset + length - 1 of the block
+  ///   void handleEvent(const MidiEvent &event, size_t offset);    apply an event at that offset, called between two render() calls
+  /// so the split lives here and voices and effects only ever see contiguous sub-blocks.
+  template <size_t BufferLength = 48, size_t MaxPending = 256>
+  class MidiBlockScheduler
+  {
+  private:
+    MidiEvent _pending[MaxPending];
+    size_t _count;
+    uint32_t _granularity;
+    uint32_t _dropped;
+    uint32_t _blockStart;
+
+  public:
+    MidiBlockScheduler() : _count(0), _granularity(1), _dropped(0), _blockStart(0) {}
+
+    /// @brief queue an event, returns false and counts it as dropped when MaxPending events are waiting
+    bool schedule(const MidiEvent &event)
+    {
+      if (_count == MaxPending)
+      {
+        _dropped++;
+        return false;
+      }
+      // insertion from the back, events mostly arrive in order so this rarely moves anything
+      size_t i = _count;
+      while (i > 0 && MidiEvent::before(event.timestamp, _pending[i - 1].timestamp))
+      {
+        _pending[i] = _pending[i - 1];
+        i--;
+      }
+      _pending[i] = event;
+      _count++;
+      return true;
+    }
+
+    void schedule(const MidiEvent *events, size_t count)
+    {
+      for (size_t i = 0; i < count; i++)
+      {
+        schedule(events[i]);
+      }
+    }
+
+    /// @brief renders one block of BufferLength samples
+    template <class Renderer>
+    void render(Renderer &renderer)
+    {
+      size_t position = 0;
+      size_t i = 0;
+      for (; i < _count; i++)
+      {
+        const uint32_t offset = _pending[i].rebase(_blockStart);
+        if (offset >= BufferLength)
+        {
+          break;
+        }
+        const size_t at = offset - offset % _granularity;
+        if (at > position)
+        {
+          renderer.render(position, at - position);
+          position = at;
+        }
+        renderer.handleEvent(_pending[i], offset);
+      }
+      if (position < BufferLength)
+      {
+        renderer.render(position, BufferLength - position);
+      }
+
+      // keep the future events
+      for (size_t j = i; j < _count; j++)
+      {
+        _pending[j - i] = _pending[j];
+      }
+      _count -= i;
+      _blockStart += BufferLength;
+    }
+
+    /// @brief moves on by one block without rendering it, for a block with nothing pending
+    inline void skip() { _blockStart += BufferLength; }
+
+    /// @brief sub-blocks start at multiples of granularity samples, trading timing accuracy for fewer, longer render() calls
+    void setGranularity(uint32_t granularity)
+    {
+      _granularity = granularity > 0 ? granularity : 1;
+    }
+
+    void clear() { _count = 0; }
+    inline size_t pending() const { return _count; }
+    inline uint32_t dropped() const { return _dropped; }
+    /// @brief sample time of the first sample of the next block
+    inline uint32_t blockStart() const { return _blockStart; }
+  };
+
+}
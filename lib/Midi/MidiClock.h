@@ -0,0 +1,171 @@
+#pragma once
+#include <stdint.h>
+#include <cstddef>
+#include <math.h>
+#include "MidiMessages.h"
+#include "MidiMessageProcessor.h"
+
+namespace Midi
+{
+
+  /// @brief Derives tempo and song position from incoming MIDI clock (24 ticks per quarter note).
+  /// A second order PLL tracks the tick period in samples so transport jitter does not reach the
+  /// tempo, and the beat position can be read at any sample of the current block.
+  /// The audio engine calls advance() once per rendered block; synced LFOs and delays read
+  /// samplesPerBeat() and beatPosition() while processing that block.
+  class MidiClock : public MidiMessageProcessor
+  {
+  public:
+    static const uint8_t TicksPerBeat = 24;
+    static const uint8_t TicksPerSongPositionBeat = 6;
+    const float DefaultBpm = 120.0f;
+    const float DefaultPhaseGain = 0.2f;
+    const float DefaultFrequencyGain = 0.01f;
+
+  private:
+    float _sampleRate;
+    float _phaseGain;
+    float _frequencyGain;
+    // PLL estimate of the tick period in samples
+    float _period;
+    // samples between the PLL estimate of the last tick and the start of the current block
+    float _elapsed;
+    // index of the last tick received while running, relative to song position zero
+    uint32_t _tick;
+    // ticks received since the PLL was seeded
+    uint32_t _lockCount;
+    bool _running;
+    bool _started;
+
+    inline float clampPeriod(float period)
+    {
+      // 20 .. 400 bpm
+      const float minPeriod = _sampleRate * 60.0f / (400.0f * TicksPerBeat);
+      const float maxPeriod = _sampleRate * 60.0f / (20.0f * TicksPerBeat);
+      return period < minPeriod ? minPeriod : (period > maxPeriod ? maxPeriod : period);
+    }
+
+    inline float tickFraction(uint32_t sampleOffset)
+    {
+      if (!_started)
+      {
+        return 0.0f;
+      }
+      const float fraction = (_elapsed + (float)sampleOffset) / _period;
+      return fraction < 0.0f ? 0.0f : (fraction > 0.999f ? 0.999f : fraction);
+    }
+
+  protected:
+    virtual void HandleTimingClock(Messages::TimingClock &msg) override { tick(msg.timestamp()); }
+    virtual void HandleStart(Messages::Start &msg) override { startPlayback(); }
+    virtual void HandleContinue(Messages::Continue &msg) override { continuePlayback(); }
+    virtual void HandleStop(Messages::Stop &msg) override { stopPlayback(); }
+    virtual void HandleSongPositionPointer(Messages::SongPositionPointer &msg) override { setSongPosition(msg.beats()); }
+
+  public:
+    MidiClock(float sampleRate) : _sampleRate(sampleRate),
+                                  _phaseGain(DefaultPhaseGain),
+                                  _frequencyGain(DefaultFrequencyGain),
+                                  _period(sampleRate * 60.0f / (DefaultBpm * TicksPerBeat)),
+                                  _elapsed(0),
+                                  _tick(0),
+                                  _lockCount(0),
+                                  _running(false),
+                                  _started(false)
+    {
+    }
+
+    /// @brief Feeds one clock tick that arrived sampleOffset samples into the current block
+    void tick(uint32_t sampleOffset)
+    {
+      const float measured = _elapsed + (float)sampleOffset;
+      if (_lockCount == 0 || measured > 4.0f * _period)
+      {
+        // first tick or a dropout: re-seed the loop on this tick
+        _elapsed = -(float)sampleOffset;
+        _lockCount = 1;
+      }
+      else if (_lockCount == 1 && measured > 0.0f)
+      {
+        // second tick: take the period directly so the loop starts close to lock
+        _period = clampPeriod(measured);
+        _elapsed = -(float)sampleOffset;
+        _lockCount++;
+      }
+      else
+      {
+        // limit the error so a burst of ticks delivered together cannot pull the loop off lock
+        float error = measured - _period;
+        error = error < -0.5f * _period ? -0.5f * _period : (error > 0.5f * _period ? 0.5f * _period : error);
+        const float estimatedTick = _period + _phaseGain * error;
+        _period = clampPeriod(_period + _frequencyGain * error);
+        _elapsed -= estimatedTick;
+        _lockCount++;
+      }
+
+      if (_running)
+      {
+        if (_started)
+        {
+          _tick++;
+        }
+        _started = true;
+      }
+    }
+
+    /// @brief Moves the clock forward by one rendered block
+    inline void advance(uint32_t samples) { _elapsed += (float)samples; }
+
+    void startPlayback()
+    {
+      _tick = 0;
+      _started = false;
+      _running = true;
+    }
+    void continuePlayback()
+    {
+      _started = _tick != 0;
+      _running = true;
+    }
+    void stopPlayback() { _running = false; }
+
+    /// @brief Sets the position from a Song Position Pointer (MIDI beats, one sixteenth note each)
+    void setSongPosition(uint16_t beats)
+    {
+      _tick = (uint32_t)beats * TicksPerSongPositionBeat;
+      _started = false;
+    }
+
+    inline bool isRunning() { return _running; }
+    inline bool isLocked() { return _lockCount > 2; }
+    inline float bpm() { return _sampleRate * 60.0f / (_period * TicksPerBeat); }
+    inline float samplesPerTick() { return _period; }
+    inline float samplesPerBeat() { return _period * TicksPerBeat; }
+
+    /// @brief Position in quarter notes at the given sample of the current block.
+    /// Holds at the next tick boundary until that tick arrives so the position never runs ahead of the master.
+    float beatPosition(uint32_t sampleOffset = 0)
+    {
+      return ((float)_tick + tickFraction(sampleOffset)) / TicksPerBeat;
+    }
+
+    /// @brief Position inside a repeating cycle of beatsPerCycle quarter notes, in the range [0, 1)
+    float cyclePosition(float beatsPerCycle, uint32_t sampleOffset = 0)
+    {
+      const double cycle = (double)beatsPerCycle * TicksPerBeat;
+      if (cycle <= 0.0)
+      {
+        return 0.0f;
+      }
+      const double ticks = (double)_tick + tickFraction(sampleOffset);
+      return (float)(fmod(ticks, cycle) / cycle);
+    }
+
+    void setLoopGains(float phaseGain, float frequencyGain)
+    {
+      _phaseGain = phaseGain;
+      _frequencyGain = frequencyGain;
+    }
+  };
+
+}
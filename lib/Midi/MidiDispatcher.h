@@ -0,0 +1,135 @@
+#pragma once
+#include <stdint.h>
+#include <cstddef>
+#include "MidiEvent.h"
+#include "MidiMessages.h"
+
+namespace Midi
+{
+
+    /// @brief The one switch from an event's status to its message type and Handle* method,
+    /// shared by MidiMessageProcessor (virtual handlers) and StaticMidiMessageProcessor (handlers resolved at compile time).
+    /// Handler needs every Handle* method of MidiMessageProcessor except HandleSystemExclusive;
+    /// non-public handlers are reachable when Handler befriends MidiDispatcher.
+    struct MidiDispatcher
+    {
+        template <class Handler>
+        static inline void dispatch(const MidiEvent &event, Handler &handler)
+        {
+            switch (event.type())
+            {
+            case MidiMessageStatus::NoteOff:
+            {
+                Messages::NoteOff msg(event);
+                handler.HandleNoteOff(msg);
+                break;
+            }
+            case MidiMessageStatus::NoteOn:
+            {
+                Messages::NoteOn msg(event);
+                handler.HandleNoteOn(msg);
+                break;
+            }
+            case MidiMessageStatus::PolyphonicKeyPressure:
+            {
+                Messages::PolyphonicKeyPressure msg(event);
+                handler.HandlePolyphonicKeyPressure(msg);
+                break;
+            }
+            case MidiMessageStatus::ControlChange:
+            {
+                Messages::ControlChange msg(event);
+                handler.HandleControlChange(msg);
+                break;
+            }
+            case MidiMessageStatus::ProgramChange:
+            {
+                Messages::ProgramChange msg(event);
+                handler.HandleProgramChange(msg);
+                break;
+            }
+            case MidiMessageStatus::ChannelPressure:
+            {
+                Messages::ChannelPressure msg(event);
+                handler.HandleChannelPressure(msg);
+                break;
+            }
+            case MidiMessageStatus::PitchBendChange:
+            {
+                Messages::PitchBendChange msg(event);
+                handler.HandlePitchBendChange(msg);
+                break;
+            }
+            case MidiMessageStatus::TimeCodeQuarterFrame:
+            {
+                Messages::TimeCodeQuarterFrame msg(event);
+                handler.HandleTimeCodeQuarterFrame(msg);
+                break;
+            }
+            case MidiMessageStatus::SongPositionPointer:
+            {
+                Messages::SongPositionPointer msg(event);
+                handler.HandleSongPositionPointer(msg);
+                break;
+            }
+            case MidiMessageStatus::SongSelect:
+            {
+                Messages::SongSelect msg(event);
+                handler.HandleSongSelect(msg);
+                break;
+            }
+            case MidiMessageStatus::TuneRequest:
+            {
+                Messages::TuneRequest msg(event);
+                handler.HandleTuneRequest(msg);
+                break;
+            }
+            case MidiMessageStatus::EndofExclusive:
+            {
+                Messages::EndofExclusive msg(event);
+                handler.HandleEndofExclusive(msg);
+                break;
+            }
+            case MidiMessageStatus::TimingClock:
+            {
+                Messages::TimingClock msg(event);
+                handler.HandleTimingClock(msg);
+                break;
+            }
+            case MidiMessageStatus::Start:
+            {
+                Messages::Start msg(event);
+                handler.HandleStart(msg);
+                break;
+            }
+            case MidiMessageStatus::Continue:
+            {
+                Messages::Continue msg(event);
+                handler.HandleContinue(msg);
+                break;
+            }
+            case MidiMessageStatus::Stop:
+            {
+                Messages::Stop msg(event);
+                handler.HandleStop(msg);
+                break;
+            }
+            case MidiMessageStatus::ActiveSensing:
+            {
+                Messages::ActiveSensing msg(event);
+                handler.HandleActiveSensing(msg);
+                break;
+            }
+            case MidiMessageStatus::Reset:
+            {
+                Messages::Reset msg(event);
+                handler.HandleReset(msg);
+                break;
+            }
+            default:
+                break;
+            }
+        }
+    };
+
+}
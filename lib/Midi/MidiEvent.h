@@ -0,0 +1,106 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <type_traits>
+
+namespace Midi
+{
+
+  namespace Constants
+  {
+    const uint8_t MaxChannels = 16;
+  }
+  // https://midi.org/summary-of-midi-1-0-messages
+  enum class MidiMessageStatus : uint8_t
+  {
+    // Channel Specific messages
+    NoteOff = 0x80,
+    NoteOn = 0x90,
+    PolyphonicKeyPressure = 0xA0,
+    ControlChange = 0xB0, // has special values 120-127
+    ProgramChange = 0xc0,
+    ChannelPressure = 0xd0,
+    PitchBendChange = 0xe0,
+    // System Common Messages
+    SystemExclusive = 0xf0,
+    TimeCodeQuarterFrame = 0xf1,
+    SongPositionPointer = 0xf2,
+    SongSelect = 0xf3,
+    TuneRequest = 0xf6,
+    EndofExclusive = 0xf7,
+    // System Realtime messages
+    TimingClock = 0xf8,
+    Start = 0xfa,
+    Continue = 0xfb,
+    Stop = 0xfc,
+    ActiveSensing = 0xfe,
+    Reset = 0xff,
+
+  };
+
+  /// @brief The in-engine representation of a MIDI message: status byte, up to two data bytes,
+  /// the number of data bytes and a timestamp. The struct is trivially copyable and 8 bytes wide, so events
+  /// can be queued, sorted and batched with plain copies. The classes in Midi::Messages are typed views over it.
+  ///
+  /// The timestamp is engine sample time: a free running sample counter that starts at 0 with the engine
+  /// and wraps after 2^32 samples (27 hours at 44.1 kHz), so times are compared by their signed difference.
+  /// Producers stamp events with the sample time they are due at (e.g. Synth::sampleTime() plus their
+  /// latency), the events go through a MidiEventQueue unchanged, and MidiBlockScheduler turns them into
+  /// an offset inside the block being rendered with rebase(). CaptureMidiSink is the one exception:
+  /// its records carry the arrival time in microseconds, see there.
+  struct MidiEvent
+  {
+    uint32_t timestamp;
+    uint8_t status;
+    uint8_t data1;
+    uint8_t data2;
+    uint8_t length;
+
+    /// @brief status with the channel stripped from channel messages
+    inline MidiMessageStatus type() const { return (status & 0xF0) == 0xF0 ? (MidiMessageStatus)status : (MidiMessageStatus)(status & 0xF0); }
+    inline uint8_t channel() const { return status & 0x0F; }
+    inline bool isChannelMessage() const { return status < 0xF0; }
+    inline bool isRealtime() const { return status >= 0xF8; }
+    inline uint16_t value14() const { return (uint16_t)data1 | ((uint16_t)data2 << 7); }
+
+    /// @brief sample offset of the event from blockStart, 0 for an event that is already due
+    inline uint32_t rebase(uint32_t blockStart) const
+    {
+      const int32_t offset = (int32_t)(timestamp - blockStart);
+      return offset > 0 ? (uint32_t)offset : 0;
+    }
+    /// @brief wrap safe order of two sample times
+    static inline bool before(uint32_t a, uint32_t b) { return (int32_t)(a - b) < 0; }
+
+    static inline MidiEvent make(uint8_t status, uint8_t data1, uint8_t data2, uint8_t length, uint32_t timestamp = 0)
+    {
+      MidiEvent event;
+      event.timestamp = timestamp;
+      event.status = status;
+      event.data1 = data1 & 0x7F;
+      event.data2 = data2 & 0x7F;
+      event.length = length;
+      return event;
+    }
+    /// @brief the channel applies to channel voice statuses only, system statuses are kept as they are
+    static inline MidiEvent make(MidiMessageStatus status, uint8_t channel, uint8_t data1, uint8_t data2, uint32_t timestamp = 0)
+    {
+      const uint8_t value = (uint8_t)status;
+      const uint8_t full = value < 0xF0 ? (uint8_t)((value & 0xF0) | (channel & 0x0F)) : value;
+      return make(full, data1, data2, dataLength(value), timestamp);
+    }
+
+    /// @brief number of data bytes that follow a status byte, SysEx is reported as 0
+    static inline uint8_t dataLength(uint8_t status)
+    {
+      static const uint8_t channelLengths[8] = {2, 2, 2, 2, 1, 1, 2, 0};
+      static const uint8_t systemLengths[16] = {0, 1, 2, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+      return status < 0xF0 ? channelLengths[(status >> 4) & 0x07] : systemLengths[status & 0x0F];
+    }
+  };
+
+  static_assert(sizeof(MidiEvent) == 8, "MidiEvent must stay 8 bytes");
+  static_assert(std::is_trivially_copyable<MidiEvent>::value, "MidiEvent must stay trivially copyable");
+
+}
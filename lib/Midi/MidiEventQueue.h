@@ -0,0 +1,192 @@
+#pragma once
+#include <stdint.h>
+#include <cstddef>
+#include <atomic>
+#include "MidiEvent.h"
+#include "MidiSink.h"
+
+namespace Midi
+{
+
+  /// @brief Wait-free single producer / single consumer ring of MidiEvents.
+  /// The transport thread pushes, the audio thread drains at the start of each block.
+  /// Neither side locks or allocates; a full queue drops the event and counts it.
+  /// Events keep their engine sample time on the way through (see MidiEvent); the audio thread hands
+  /// them to a MidiBlockScheduler, which rebases them onto the block they fall into.
+  template <size_t Capacity = 256>
+  class MidiEventQueue
+  {
+    static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+  private:
+    static const uint32_t Mask = Capacity - 1;
+    MidiEvent _events[Capacity];
+    // producer and consumer indices live on separate cache lines,
+    // the producer's overflow count on a third so it never invalidates the consumer's line
+    alignas(64) std::atomic<uint32_t> _head;
+    alignas(64) std::atomic<uint32_t> _tail;
+    alignas(64) std::atomic<uint32_t> _overflows;
+
+  public:
+    MidiEventQueue() : _head(0), _tail(0), _overflows(0) {}
+
+    /// @brief producer side, returns false and counts an overflow when the queue is full
+    bool push(const MidiEvent &event)
+    {
+      const uint32_t head = _head.load(std::memory_order_relaxed);
+      const uint32_t tail = _tail.load(std::memory_order_acquire);
+      if (head - tail >= Capacity)
+      {
+        _overflows.fetch_add(1, std::memory_order_relaxed);
+        return false;
+      }
+      _events[head & Mask] = event;
+      _head.store(head + 1, std::memory_order_release);
+      return true;
+    }
+
+    /// @brief consumer side
+    bool pop(MidiEvent &event)
+    {
+      const uint32_t tail = _tail.load(std::memory_order_relaxed);
+      const uint32_t head = _head.load(std::memory_order_acquire);
+      if (head == tail)
+      {
+        return false;
+      }
+      event = _events[tail & Mask];
+      _tail.store(tail + 1, std::memory_order_release);
+      return true;
+    }
+
+    /// @brief consumer side, reads the oldest event without removing it
+    bool peek(MidiEvent &event) const
+    {
+      const uint32_t tail = _tail.load(std::memory_order_relaxed);
+      const uint32_t head = _head.load(std::memory_order_acquire);
+      if (head == tail)
+      {
+        return false;
+      }
+      event = _events[tail & Mask];
+      return true;
+    }
+
+    /// @brief consumer side, copies up to maxEvents into events and returns how many were copied
+    size_t drain(MidiEvent *events, size_t maxEvents)
+    {
+      const uint32_t tail = _tail.load(std::memory_order_relaxed);
+      const uint32_t head = _head.load(std::memory_order_acquire);
+      size_t count = head - tail;
+      if (count > maxEvents)
+      {
+        count = maxEvents;
+      }
+      for (size_t i = 0; i < count; i++)
+      {
+        events[i] = _events[(tail + i) & Mask];
+      }
+      _tail.store(tail + (uint32_t)count, std::memory_order_release);
+      return count;
+    }
+
+    inline size_t size() const { return _head.load(std::memory_order_acquire) - _tail.load(std::memory_order_acquire); }
+    inline bool empty() const { return size() == 0; }
+    inline size_t capacity() const { return Capacity; }
+
+    /// @brief events dropped because the queue was full
+    inline uint32_t overflows() const { return _overflows.load(std::memory_order_relaxed); }
+    /// @brief returns the overflow count and starts counting from zero
+    inline uint32_t takeOverflows() { return _overflows.exchange(0, std::memory_order_relaxed); }
+  };
+
+  /// @brief Several transports feeding one audio thread. Every producer owns a lane (its own SPSC ring),
+  /// so pushing stays wait-free without a shared index; the consumer merges the lanes by timestamp.
+  template <size_t Capacity = 256, size_t Producers = 2>
+  class MultiProducerMidiEventQueue
+  {
+  private:
+    MidiEventQueue<Capacity> _lanes[Producers];
+    // lane that wins the next timestamp tie, moves on after every event so no lane is starved
+    size_t _next;
+
+  public:
+    MultiProducerMidiEventQueue() : _next(0) {}
+
+    /// @brief the queue producer number index pushes to, one lane per transport thread
+    inline MidiEventQueue<Capacity> &lane(size_t index) { return _lanes[index]; }
+    inline bool push(size_t producer, const MidiEvent &event) { return _lanes[producer].push(event); }
+
+    /// @brief copies up to maxEvents in timestamp order across the lanes, each lane is already in order
+    size_t drain(MidiEvent *events, size_t maxEvents)
+    {
+      size_t count = 0;
+      while (count < maxEvents)
+      {
+        size_t earliest = Producers;
+        MidiEvent candidate;
+        for (size_t n = 0; n < Producers; n++)
+        {
+          const size_t i = (_next + n) % Producers;
+          MidiEvent event;
+          // wrap safe comparison, timestamps are a free running sample counter
+          if (_lanes[i].peek(event) && (earliest == Producers || MidiEvent::before(event.timestamp, candidate.timestamp)))
+          {
+            earliest = i;
+            candidate = event;
+          }
+        }
+        if (earliest == Producers)
+        {
+          break;
+        }
+        _lanes[earliest].pop(events[count++]);
+        _next = (earliest + 1) % Producers;
+      }
+      return count;
+    }
+
+    size_t size() const
+    {
+      size_t count = 0;
+      for (size_t i = 0; i < Producers; i++)
+      {
+        count += _lanes[i].size();
+      }
+      return count;
+    }
+
+    uint32_t overflows() const
+    {
+      uint32_t count = 0;
+      for (size_t i = 0; i < Producers; i++)
+      {
+        count += _lanes[i].overflows();
+      }
+      return count;
+    }
+  };
+
+  /// @brief Lets a transport callback or any MidiSink chain hand events to the audio thread through a queue
+  template <size_t Capacity = 256>
+  class MidiEventQueueSink : public MidiSink
+  {
+  private:
+    MidiEventQueue<Capacity> &_queue;
+    bool _isConnected;
+
+  public:
+    MidiEventQueueSink(MidiEventQueue<Capacity> &queue) : _queue(queue), _isConnected(false) {}
+    virtual void send(const MidiEvent &event) override
+    {
+      if (_isConnected)
+      {
+        _queue.push(event);
+      }
+    }
+    virtual void start() override { _isConnected = true; }
+    virtual void stop() override { _isConnected = false; }
+    virtual bool isConnected() override { return _isConnected; }
+  };
+
+}
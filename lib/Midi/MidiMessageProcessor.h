@@ -2,6 +2,7 @@
 #include <stdint.h>
 #include <cstddef>
 #include "MidiMessages.h"
+#include "MidiDispatcher.h"
 
 #include <string>
 #include "MidiSink.h"
@@ -12,6 +13,7 @@ namespace Midi
     class MidiMessageProcessor : public MidiSink
     {
     protected:
+        friend struct MidiDispatcher;
         bool _isConnected = false;
         virtual void HandleNoteOff(Messages::NoteOff &msg) {}
         virtual void HandleNoteOn(Messages::NoteOn &msg) {}
@@ -31,73 +33,22 @@ namespace Midi
         virtual void HandleStop(Messages::Stop &msg) {}
         virtual void HandleActiveSensing(Messages::ActiveSensing &msg) {}
         virtual void HandleReset(Messages::Reset &msg) {}
+        virtual void HandleSystemExclusive(const SysExChunk &chunk) {}
 
     public:
         MidiMessageProcessor() : _isConnected(false) {}
-        virtual void send(Midi::MidiMessage message) override
+        virtual void send(const MidiEvent &event) override
         {
             if (_isConnected)
             {
-                auto status = message.status();
-                switch (status)
-                {
-                case MidiMessageStatus::NoteOff:
-                    HandleNoteOff(static_cast<Messages::NoteOff &>(message));
-                    break;
-                case MidiMessageStatus::NoteOn:
-                    HandleNoteOn(static_cast<Messages::NoteOn &>(message));
-                    break;
-                case MidiMessageStatus::PolyphonicKeyPressure:
-                    HandlePolyphonicKeyPressure(static_cast<Messages::PolyphonicKeyPressure &>(message));
-                    break;
-                case MidiMessageStatus::ControlChange:
-                    HandleControlChange(static_cast<Messages::ControlChange &>(message));
-                    break;
-                case MidiMessageStatus::ProgramChange:
-                    HandleProgramChange(static_cast<Messages::ProgramChange &>(message));
-                    break;
-                case MidiMessageStatus::ChannelPressure:
-                    HandleChannelPressure(static_cast<Messages::ChannelPressure &>(message));
-                    break;
-                case MidiMessageStatus::PitchBendChange:
-                    HandlePitchBendChange(static_cast<Messages::PitchBendChange &>(message));
-                    break;
-                case MidiMessageStatus::TimeCodeQuarterFrame:
-                    HandleTimeCodeQuarterFrame(static_cast<Messages::TimeCodeQuarterFrame &>(message));
-                    break;
-                case MidiMessageStatus::SongPositionPointer:
-                    HandleSongPositionPointer(static_cast<Messages::SongPositionPointer &>(message));
-                    break;
-                case MidiMessageStatus::SongSelect:
-                    HandleSongSelect(static_cast<Messages::SongSelect &>(message));
-                    break;
-                case MidiMessageStatus::TuneRequest:
-                    HandleTuneRequest(static_cast<Messages::TuneRequest &>(message));
-                    break;
-                case MidiMessageStatus::EndofExclusive:
-                    HandleEndofExclusive(static_cast<Messages::EndofExclusive &>(message));
-                    break;
-                case MidiMessageStatus::TimingClock:
-                    HandleTimingClock(static_cast<Messages::TimingClock &>(message));
-                    break;
-                case MidiMessageStatus::Start:
-                    HandleStart(static_cast<Messages::Start &>(message));
-                    break;
-                case MidiMessageStatus::Continue:
-                    HandleContinue(static_cast<Messages::Continue &>(message));
-                    break;
-                case MidiMessageStatus::Stop:
-                    HandleStop(static_cast<Messages::Stop &>(message));
-                    break;
-                case MidiMessageStatus::ActiveSensing:
-                    HandleActiveSensing(static_cast<Messages::ActiveSensing &>(message));
-                    break;
-                case MidiMessageStatus::Reset:
-                    HandleReset(static_cast<Messages::Reset &>(message));
-                    break;
-                default:
-                    break;
-                }
+                MidiDispatcher::dispatch(event, *this);
+            }
+        }
+        virtual void sendSysEx(const SysExChunk &chunk) override
+        {
+            if (_isConnected)
+            {
+                HandleSystemExclusive(chunk);
             }
         }
         virtual void start() override { _isConnected = true; }
@@ -0,0 +1,225 @@
+#pragma once
+#include <stdint.h>
+#include <cstddef>
+#include "MidiEvent.h"
+#include "MidiSink.h"
+
+namespace Midi
+{
+
+  /// @brief Routing matrix sink, forwards each event to any of up to MaxOutputs sinks.
+  /// Every output has a channel mask, a message type mask, and optionally a note range (for splits),
+  /// a transposition and a channel remap. The channel and type filters are folded into a table
+  /// indexed by status byte whenever the configuration changes, so routing an event is one table read
+  /// followed by a send per selected output. Replaces nesting CompositeMidiSinks for splits and layers.
+  template <size_t MaxOutputs = 8>
+  class MidiRouter : public MidiSink
+  {
+    static_assert(MaxOutputs <= 32, "outputs are selected with a 32 bit mask");
+
+  public:
+    /// @brief bit of a message type in a type mask, channel messages in the low bits, system messages from bit 16
+    static inline uint32_t typeBit(MidiMessageStatus type) { return statusBit((uint8_t)type); }
+    static inline uint32_t statusBit(uint8_t status)
+    {
+      return status < 0xF0 ? (1u << ((status >> 4) - 8)) : (1u << (16 + (status & 0x0F)));
+    }
+    static const uint32_t AllTypes = 0xFFFFFFFF;
+    static const uint16_t AllChannels = 0xFFFF;
+
+  private:
+    struct Output
+    {
+      MidiSink *sink;
+      uint16_t channels;
+      uint32_t types;
+      int8_t transpose;
+      int8_t channel;
+      uint8_t lowNote;
+      uint8_t highNote;
+    };
+
+    Output _outputs[MaxOutputs];
+    size_t _outputCount;
+    uint32_t _table[256];
+    // outputs that change or filter note messages and need the slow path
+    uint32_t _rewriting;
+
+    void rebuild()
+    {
+      _rewriting = 0;
+      for (size_t i = 0; i < _outputCount; i++)
+      {
+        const Output &output = _outputs[i];
+        if (output.transpose != 0 || output.channel >= 0 || output.lowNote > 0 || output.highNote < 127)
+        {
+          _rewriting |= 1u << i;
+        }
+      }
+      for (size_t status = 0; status < 256; status++)
+      {
+        uint32_t selected = 0;
+        if (status >= 0x80)
+        {
+          const uint32_t bit = statusBit((uint8_t)status);
+          for (size_t i = 0; i < _outputCount; i++)
+          {
+            const Output &output = _outputs[i];
+            const bool channelMatch = status >= 0xF0 || (output.channels & (1u << (status & 0x0F)));
+            if ((output.types & bit) && channelMatch)
+            {
+              selected |= 1u << i;
+            }
+          }
+        }
+        _table[status] = selected;
+      }
+    }
+
+    static inline bool isNote(uint8_t status)
+    {
+      return status >= 0x80 && status < 0xB0;
+    }
+
+    /// @brief applies the output's remap, returns false when the event is filtered out
+    inline bool rewrite(const Output &output, MidiEvent &event)
+    {
+      if (event.isChannelMessage())
+      {
+        if (isNote(event.status))
+        {
+          if (event.data1 < output.lowNote || event.data1 > output.highNote)
+          {
+            return false;
+          }
+          const int note = (int)event.data1 + output.transpose;
+          if (note < 0 || note > 127)
+          {
+            return false;
+          }
+          event.data1 = (uint8_t)note;
+        }
+        if (output.channel >= 0)
+        {
+          event.status = (event.status & 0xF0) | (uint8_t)output.channel;
+        }
+      }
+      return true;
+    }
+
+  public:
+    MidiRouter() : _outputCount(0), _rewriting(0) { rebuild(); }
+
+    /// @brief returns the index of the new output, or -1 when all MaxOutputs are in use
+    int addOutput(MidiSink &sink, uint16_t channels = AllChannels, uint32_t types = AllTypes)
+    {
+      if (_outputCount == MaxOutputs)
+      {
+        return -1;
+      }
+      Output &output = _outputs[_outputCount];
+      output.sink = &sink;
+      output.channels = channels;
+      output.types = types;
+      output.transpose = 0;
+      output.channel = -1;
+      output.lowNote = 0;
+      output.highNote = 127;
+      _outputCount++;
+      rebuild();
+      return (int)_outputCount - 1;
+    }
+
+    void setChannels(size_t output, uint16_t channels)
+    {
+      _outputs[output].channels = channels;
+      rebuild();
+    }
+
+    void setTypes(size_t output, uint32_t types)
+    {
+      _outputs[output].types = types;
+      rebuild();
+    }
+
+    /// @brief only notes from low to high (inclusive, before transposition) pass, for keyboard splits
+    void setNoteRange(size_t output, uint8_t low, uint8_t high)
+    {
+      _outputs[output].lowNote = low;
+      _outputs[output].highNote = high;
+      rebuild();
+    }
+
+    /// @brief notes moved out of the MIDI range are dropped
+    void setTranspose(size_t output, int8_t semitones)
+    {
+      _outputs[output].transpose = semitones;
+      rebuild();
+    }
+
+    /// @brief send all channel messages on channel, -1 keeps the original channel
+    void setChannelRemap(size_t output, int8_t channel)
+    {
+      _outputs[output].channel = channel < 0 ? -1 : (int8_t)(channel & 0x0F);
+      rebuild();
+    }
+
+    virtual void send(const MidiEvent &event) override
+    {
+      uint32_t selected = _table[event.status];
+      while (selected != 0)
+      {
+        const uint32_t i = __builtin_ctz(selected);
+        selected &= selected - 1;
+        if (_rewriting & (1u << i))
+        {
+          MidiEvent routed = event;
+          if (rewrite(_outputs[i], routed))
+          {
+            _outputs[i].sink->send(routed);
+          }
+        }
+        else
+        {
+          _outputs[i].sink->send(event);
+        }
+      }
+    }
+
+    virtual void sendSysEx(const SysExChunk &chunk) override
+    {
+      uint32_t selected = _table[0xF0];
+      while (selected != 0)
+      {
+        const uint32_t i = __builtin_ctz(selected);
+        selected &= selected - 1;
+        _outputs[i].sink->sendSysEx(chunk);
+      }
+    }
+
+    virtual void start() override
+    {
+      for (size_t i = 0; i < _outputCount; i++)
+      {
+        _outputs[i].sink->start();
+      }
+    }
+    virtual void stop() override
+    {
+      for (size_t i = 0; i < _outputCount; i++)
+      {
+        _outputs[i].sink->stop();
+      }
+    }
+    virtual bool isConnected() override
+    {
+      bool connected = true;
+      for (size_t i = 0; i < _outputCount; i++)
+      {
+        connected &= _outputs[i].sink->isConnected();
+      }
+      return connected;
+    }
+  };
+
+}
@@ -1,7 +1,9 @@
 #pragma once
 #include <stdint.h>
 #include <cstddef>
+#include "MidiEvent.h"
 #include "MidiMessages.h"
+#include "SysEx.h"
 
 #include <string>
 
@@ -12,7 +14,10 @@ namespace Midi
   class MidiSink
   {
   public:
-    virtual void send(Midi::MidiMessage message) = 0;
+    /// @brief Messages::* views convert to const MidiEvent &, so sink.send(Messages::NoteOn(...)) works unchanged
+    virtual void send(const MidiEvent &event) = 0;
+    /// @brief System Exclusive payloads do not fit a MidiEvent and arrive here in chunks, sinks that do not care ignore them
+    virtual void sendSysEx(const SysExChunk &chunk) {}
     virtual void start() = 0;
     virtual void stop() = 0;
     virtual bool isConnected() = 0;
@@ -1,7 +1,7 @@
 #pragma once
 #include <stdint.h>
 #include <cstddef>
-#include "MidiMessages.h"
+#include "MidiEvent.h"
 #include <functional>
 #include <string>
 
@@ -12,10 +12,10 @@ namespace Midi
   class MidiSource
   {
   protected:
-    std::function<void(const MidiMessage &)> _recievedCallback = nullptr;
+    std::function<void(const MidiEvent &)> _recievedCallback = nullptr;
 
   public:
-    MidiSource(std::function<void(const MidiMessage &)> recievedCallback) : _recievedCallback(recievedCallback) {}
+    MidiSource(std::function<void(const MidiEvent &)> recievedCallback) : _recievedCallback(recievedCallback) {}
     virtual void start() = 0;
     virtual void stop() = 0;
     virtual bool isConnected() = 0;
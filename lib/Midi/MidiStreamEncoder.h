@@ -0,0 +1,211 @@
+#pragma once
+#include <stdint.h>
+#include <cstddef>
+#include <string.h>
+#include "MidiEvent.h"
+#include "MidiSink.h"
+#include "SysEx.h"
+
+namespace Midi
+{
+
+  /// @brief Serializes spans of events into MIDI 1.0 wire bytes, the counterpart of MidiStreamParser.
+  /// Channel messages use running status, optionally with Note Off sent as Note On with velocity 0 so
+  /// note streams stay in one status. Realtime events of a span are written first, ahead of the
+  /// messages they were queued behind. The running status survives across calls, call resetRunningStatus()
+  /// when the receiver may have lost it (reconnect, after another writer used the line).
+  class MidiStreamEncoder
+  {
+  private:
+    uint8_t _runningStatus;
+    bool _useRunningStatus;
+    bool _noteOffAsNoteOn;
+
+    inline uint8_t wireStatus(const MidiEvent &event) const
+    {
+      if (_noteOffAsNoteOn && event.type() == MidiMessageStatus::NoteOff)
+      {
+        return (uint8_t)MidiMessageStatus::NoteOn | event.channel();
+      }
+      return event.status;
+    }
+
+    static inline uint8_t dataLength(const MidiEvent &event)
+    {
+      return event.length > 2 ? 2 : event.length;
+    }
+
+  public:
+    MidiStreamEncoder() : _runningStatus(0), _useRunningStatus(true), _noteOffAsNoteOn(false) {}
+
+    /// @brief the largest number of bytes count events can take
+    static inline size_t maxEncodedLength(size_t count) { return count * 3; }
+
+    /**
+     * Writes as many events from the start of the span as fit into buffer.
+     * @param consumed receives the number of events written
+     * @return the number of bytes written
+     */
+    size_t encode(const MidiEvent *events, size_t count, uint8_t *buffer, size_t capacity, size_t &consumed)
+    {
+      // exact size of the longest prefix that fits, realtime bytes do not affect running status
+      size_t fitting = 0;
+      size_t bytes = 0;
+      uint8_t running = _runningStatus;
+      for (; fitting < count; fitting++)
+      {
+        const MidiEvent &event = events[fitting];
+        size_t size;
+        if (event.isRealtime())
+        {
+          size = 1;
+        }
+        else
+        {
+          const uint8_t status = wireStatus(event);
+          size = dataLength(event) + ((_useRunningStatus && status == running) ? 0 : 1);
+          running = status < 0xF0 ? status : 0;
+        }
+        if (bytes + size > capacity)
+        {
+          break;
+        }
+        bytes += size;
+      }
+
+      size_t length = 0;
+      for (size_t i = 0; i < fitting; i++)
+      {
+        if (events[i].isRealtime())
+        {
+          buffer[length++] = events[i].status;
+        }
+      }
+      for (size_t i = 0; i < fitting; i++)
+      {
+        const MidiEvent &event = events[i];
+        if (event.isRealtime())
+        {
+          continue;
+        }
+        const uint8_t status = wireStatus(event);
+        if (!_useRunningStatus || status != _runningStatus)
+        {
+          buffer[length++] = status;
+        }
+        _runningStatus = status < 0xF0 ? status : 0;
+        const uint8_t data = dataLength(event);
+        if (data > 0)
+        {
+          buffer[length++] = event.data1;
+        }
+        if (data > 1)
+        {
+          // velocity 0 of a rewritten Note Off
+          buffer[length++] = status != event.status ? 0 : event.data2;
+        }
+      }
+      consumed = fitting;
+      return length;
+    }
+
+    /// @brief writes a SysEx chunk, F0 in front of the first and F7 after the last unless it was aborted,
+    /// returns the bytes written or 0 when it does not fit
+    size_t encodeSysEx(const SysExChunk &chunk, uint8_t *buffer, size_t capacity)
+    {
+      const bool terminated = chunk.last && !chunk.aborted;
+      const size_t needed = chunk.length + (chunk.first ? 1 : 0) + (terminated ? 1 : 0);
+      if (needed > capacity)
+      {
+        return 0;
+      }
+      size_t length = 0;
+      if (chunk.first)
+      {
+        buffer[length++] = 0xF0;
+      }
+      memcpy(buffer + length, chunk.data, chunk.length);
+      length += chunk.length;
+      if (terminated)
+      {
+        buffer[length++] = 0xF7;
+      }
+      _runningStatus = 0;
+      return length;
+    }
+
+    inline void resetRunningStatus() { _runningStatus = 0; }
+    void setRunningStatus(bool enabled)
+    {
+      _useRunningStatus = enabled;
+      _runningStatus = 0;
+    }
+    /// @brief Note Off becomes Note On with velocity 0, the release velocity is lost
+    void setNoteOffAsNoteOn(bool enabled) { _noteOffAsNoteOn = enabled; }
+  };
+
+  /// @brief Base for byte stream transports (UART, BLE, ...). send() only queues the event;
+  /// flush() encodes everything queued with one MidiStreamEncoder pass and hands the bytes to write()
+  /// in as few calls as BufferLength allows. The queue is flushed on its own when it runs full.
+  template <size_t BufferLength = 256, size_t MaxPending = 64>
+  class EncodingMidiSink : public MidiSink
+  {
+    static_assert(BufferLength >= 3, "the buffer has to hold at least one message");
+
+  private:
+    MidiEvent _pending[MaxPending];
+    size_t _pendingCount;
+    uint8_t _buffer[BufferLength];
+
+  protected:
+    MidiStreamEncoder _encoder;
+
+    /// @brief puts encoded bytes on the wire
+    virtual void write(const uint8_t *data, size_t length) = 0;
+
+  public:
+    EncodingMidiSink() : _pendingCount(0) {}
+
+    virtual void send(const MidiEvent &event) override
+    {
+      _pending[_pendingCount++] = event;
+      if (_pendingCount == MaxPending)
+      {
+        flush();
+      }
+    }
+
+    virtual void sendSysEx(const SysExChunk &chunk) override
+    {
+      flush();
+      SysExChunk part = chunk;
+      // a chunk larger than the buffer goes out in pieces, F0 on the first and F7 on the last
+      while (part.length + 2 > BufferLength)
+      {
+        SysExChunk piece = part;
+        piece.length = BufferLength - 2;
+        piece.last = false;
+        piece.aborted = false;
+        write(_buffer, _encoder.encodeSysEx(piece, _buffer, BufferLength));
+        part.data += piece.length;
+        part.length -= piece.length;
+        part.first = false;
+      }
+      write(_buffer, _encoder.encodeSysEx(part, _buffer, BufferLength));
+    }
+
+    void flush()
+    {
+      size_t offset = 0;
+      while (offset < _pendingCount)
+      {
+        size_t consumed;
+        const size_t length = _encoder.encode(_pending + offset, _pendingCount - offset, _buffer, BufferLength, consumed);
+        write(_buffer, length);
+        offset += consumed;
+      }
+      _pendingCount = 0;
+    }
+  };
+
+}
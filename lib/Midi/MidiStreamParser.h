@@ -0,0 +1,204 @@
+#pragma once
+#include <stdint.h>
+#include <cstddef>
+#include "MidiEvent.h"
+#include "SysEx.h"
+
+namespace Midi
+{
+
+  /// @brief Incremental MIDI 1.0 byte stream parser.
+  /// Accepts chunks of any size, all state (running status, partially received messages, an open SysEx)
+  /// carries over to the next call. Realtime bytes may appear anywhere, also inside other messages,
+  /// and are emitted without disturbing the message around them.
+  ///
+  /// Parsed events are collected in a fixed batch and handed over with handler.onEvents(const MidiEvent *events, size_t count),
+  /// once the batch is full and at the end of every parse() call.
+  /// SysEx payloads are not copied, handler.onSysEx(const SysExChunk &chunk) receives spans into the parsed buffer;
+  /// pending events are handed over first so the order of the stream is kept.
+  template <size_t BatchLength = 32>
+  class MidiStreamParser
+  {
+  private:
+    /// @brief per status byte: number of data bytes in the low bits plus the flags below
+    enum StatusClass : uint8_t
+    {
+      LengthMask = 0x03,
+      Realtime = 0x10,
+      SysExStart = 0x20,
+      SysExEnd = 0x40,
+      Undefined = 0x80,
+    };
+
+    static inline uint8_t classify(uint8_t status)
+    {
+      // 0x80 .. 0xE0, indexed by the high nibble
+      static const uint8_t channelTable[8] = {2, 2, 2, 2, 1, 1, 2, 0};
+      // 0xF0 .. 0xFF
+      static const uint8_t systemTable[16] = {
+          SysExStart, 1, 2, 1, Undefined, Undefined, 0, SysExEnd,
+          Realtime, Realtime | Undefined, Realtime, Realtime, Realtime, Realtime | Undefined, Realtime, Realtime};
+      return status < 0xF0 ? channelTable[(status >> 4) & 0x07] : systemTable[status & 0x0F];
+    }
+
+    MidiEvent _batch[BatchLength];
+    size_t _batchCount;
+    uint8_t _status;
+    uint8_t _expected;
+    uint8_t _count;
+    uint8_t _data[2];
+    bool _inSysEx;
+    bool _sysExFirst;
+    uint32_t _droppedBytes;
+
+    template <class Handler>
+    inline void emit(Handler &handler, uint8_t status, uint8_t data1, uint8_t data2, uint8_t length, uint32_t timestamp)
+    {
+      MidiEvent &event = _batch[_batchCount++];
+      event.timestamp = timestamp;
+      event.status = status;
+      event.data1 = data1;
+      event.data2 = data2;
+      event.length = length;
+      if (_batchCount == BatchLength)
+      {
+        flush(handler);
+      }
+    }
+
+    template <class Handler>
+    inline void flush(Handler &handler)
+    {
+      if (_batchCount > 0)
+      {
+        handler.onEvents(_batch, _batchCount);
+        _batchCount = 0;
+      }
+    }
+
+    template <class Handler>
+    inline void sysEx(Handler &handler, const uint8_t *data, size_t length, bool last, bool aborted, uint32_t timestamp)
+    {
+      if (length == 0 && !last)
+      {
+        return;
+      }
+      flush(handler);
+      SysExChunk chunk;
+      chunk.data = data;
+      chunk.length = length;
+      chunk.timestamp = timestamp;
+      chunk.first = _sysExFirst;
+      chunk.last = last;
+      chunk.aborted = aborted;
+      _sysExFirst = false;
+      handler.onSysEx(chunk);
+    }
+
+  public:
+    MidiStreamParser() { reset(); }
+
+    /// @brief forget running status and any partial message, e.g. after a transport reconnect
+    void reset()
+    {
+      _batchCount = 0;
+      _status = 0;
+      _expected = 0;
+      _count = 0;
+      _data[0] = 0;
+      _data[1] = 0;
+      _inSysEx = false;
+      _sysExFirst = false;
+      _droppedBytes = 0;
+    }
+
+    /// @brief parses length bytes, every event produced gets the given timestamp (engine sample time, see MidiEvent)
+    template <class Handler>
+    void parse(const uint8_t *data, size_t length, Handler &handler, uint32_t timestamp = 0)
+    {
+      // start of the SysEx bytes not yet delivered
+      size_t sysExStart = 0;
+      for (size_t i = 0; i < length; i++)
+      {
+        const uint8_t b = data[i];
+        if (b < 0x80)
+        {
+          if (_inSysEx)
+          {
+            continue;
+          }
+          if (_status == 0)
+          {
+            // data without a status, nothing to attach it to
+            _droppedBytes++;
+            continue;
+          }
+          _data[_count++] = b;
+          if (_count == _expected)
+          {
+            emit(handler, _status, _data[0], _expected > 1 ? _data[1] : 0, _expected, timestamp);
+            _count = 0;
+            if (_status >= 0xF0)
+            {
+              // only channel messages establish running status
+              _status = 0;
+            }
+          }
+          continue;
+        }
+
+        const uint8_t info = classify(b);
+        if (info & Realtime)
+        {
+          if (_inSysEx)
+          {
+            sysEx(handler, data + sysExStart, i - sysExStart, false, false, timestamp);
+            sysExStart = i + 1;
+          }
+          if (!(info & Undefined))
+          {
+            emit(handler, b, 0, 0, 0, timestamp);
+          }
+          continue;
+        }
+
+        // any other status byte ends an open SysEx and cancels a partial message
+        if (_inSysEx)
+        {
+          sysEx(handler, data + sysExStart, i - sysExStart, true, b != 0xF7, timestamp);
+          _inSysEx = false;
+        }
+        _count = 0;
+        if (info & (SysExStart | SysExEnd | Undefined))
+        {
+          if (info & SysExStart)
+          {
+            _inSysEx = true;
+            _sysExFirst = true;
+            sysExStart = i + 1;
+          }
+          _status = 0;
+          continue;
+        }
+        _status = b;
+        _expected = info & LengthMask;
+        if (_expected == 0)
+        {
+          emit(handler, b, 0, 0, 0, timestamp);
+          _status = 0;
+        }
+      }
+      if (_inSysEx)
+      {
+        sysEx(handler, data + sysExStart, length - sysExStart, false, false, timestamp);
+      }
+      flush(handler);
+    }
+
+    /// @brief a SysEx is open and will continue with the next chunk
+    inline bool inSysEx() const { return _inSysEx; }
+    /// @brief data bytes received without a status byte in effect
+    inline uint32_t droppedBytes() const { return _droppedBytes; }
+  };
+
+}
@@ -0,0 +1,452 @@
+#pragma once
+#include <stdint.h>
+#include <cstddef>
+#include "MidiEvent.h"
+#include "SysEx.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define MIDI_SMF_MMAP 1
+#endif
+
+namespace Midi
+{
+
+  /// @brief Standard MIDI File (format 0 and 1) over a read-only byte range.
+  /// open() memory-maps the file on unix hosts; load() uses bytes that are already in memory
+  /// (flash, a partition, a test vector) and must stay valid while the file is used.
+  /// Nothing is copied, tracks are located by walking the chunk headers.
+  class StandardMidiFile
+  {
+  private:
+    const uint8_t *_data;
+    size_t _length;
+    bool _mapped;
+    uint16_t _format;
+    uint16_t _trackCount;
+    uint16_t _division;
+
+    static inline uint32_t read32(const uint8_t *p) { return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3]; }
+    static inline uint16_t read16(const uint8_t *p) { return (uint16_t)((p[0] << 8) | p[1]); }
+    static inline bool isChunk(const uint8_t *p, const char *id) { return p[0] == id[0] && p[1] == id[1] && p[2] == id[2] && p[3] == id[3]; }
+
+    bool parseHeader()
+    {
+      if (_length < 14 || !isChunk(_data, "MThd") || read32(_data + 4) < 6)
+      {
+        return false;
+      }
+      _format = read16(_data + 8);
+      _trackCount = read16(_data + 10);
+      _division = read16(_data + 12);
+      return _format <= 1 && _division != 0;
+    }
+
+    /// @brief takes the byte range without releasing the current one, open() has already set _mapped for it
+    bool attach(const uint8_t *data, size_t length)
+    {
+      _data = data;
+      _length = length;
+      if (!parseHeader())
+      {
+        _trackCount = 0;
+        return false;
+      }
+      return true;
+    }
+
+  public:
+    StandardMidiFile() : _data(nullptr), _length(0), _mapped(false), _format(0), _trackCount(0), _division(0) {}
+    StandardMidiFile(const StandardMidiFile &) = delete;
+    StandardMidiFile &operator=(const StandardMidiFile &) = delete;
+    ~StandardMidiFile() { close(); }
+
+#ifdef MIDI_SMF_MMAP
+    bool open(const char *path)
+    {
+      close();
+      const int fd = ::open(path, O_RDONLY);
+      if (fd < 0)
+      {
+        return false;
+      }
+      struct stat info;
+      void *mapping = MAP_FAILED;
+      if (fstat(fd, &info) == 0 && info.st_size > 0)
+      {
+        mapping = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      }
+      ::close(fd);
+      if (mapping == MAP_FAILED)
+      {
+        return false;
+      }
+      madvise(mapping, (size_t)info.st_size, MADV_SEQUENTIAL);
+      _mapped = true;
+      if (!attach((const uint8_t *)mapping, (size_t)info.st_size))
+      {
+        close();
+        return false;
+      }
+      return true;
+    }
+#endif
+
+    /// @brief uses bytes that are already in memory, a file opened before is closed first
+    bool load(const uint8_t *data, size_t length)
+    {
+      close();
+      return attach(data, length);
+    }
+
+    void close()
+    {
+#ifdef MIDI_SMF_MMAP
+      if (_mapped)
+      {
+        munmap((void *)_data, _length);
+      }
+#endif
+      _mapped = false;
+      _data = nullptr;
+      _length = 0;
+      _trackCount = 0;
+    }
+
+    /// @brief the event data of track index, false when the file has fewer tracks;
+    /// a track cut short by the end of the file is returned with the bytes that are there
+    bool track(size_t index, const uint8_t *&data, size_t &length) const
+    {
+      const uint32_t headerLength = read32(_data + 4);
+      if (headerLength > _length - 8)
+      {
+        return false;
+      }
+      size_t offset = 8 + headerLength;
+      size_t found = 0;
+      while (_length - offset >= 8)
+      {
+        const uint32_t chunkLength = read32(_data + offset + 4);
+        const size_t end = chunkLength > _length - offset - 8 ? _length : offset + 8 + chunkLength;
+        if (isChunk(_data + offset, "MTrk"))
+        {
+          if (found == index)
+          {
+            data = _data + offset + 8;
+            length = end - offset - 8;
+            return true;
+          }
+          found++;
+        }
+        offset = end;
+      }
+      return false;
+    }
+
+    inline bool valid() const { return _trackCount > 0; }
+    inline uint16_t format() const { return _format; }
+    inline uint16_t trackCount() const { return _trackCount; }
+    /// @brief ticks per quarter note, or SMPTE frames (negative, high byte) and ticks per frame when bit 15 is set
+    inline uint16_t division() const { return _division; }
+  };
+
+  /// @brief Streams a StandardMidiFile into the engine block by block.
+  /// Tracks are merged lazily with a min-heap of track cursors ordered by the tick of their next event,
+  /// so only the next event of every track is ever looked at. Ticks are converted to samples with the
+  /// tempo map as it is encountered.
+  ///
+  /// render() uses the same handler as MidiStreamParser: onEvents(const MidiEvent *events, size_t count)
+  /// and onSysEx(const SysExChunk &chunk) with spans into the file. Timestamps are engine sample time
+  /// (see MidiEvent), the block's sample time plus the event's offset in it.
+  template <size_t MaxTracks = 64, size_t BatchLength = 32>
+  class StandardMidiFilePlayer
+  {
+    static_assert(MaxTracks <= 256, "track indices are stored as bytes");
+
+  private:
+    struct TrackCursor
+    {
+      const uint8_t *position;
+      const uint8_t *end;
+      uint64_t tick;
+      uint8_t runningStatus;
+    };
+
+    const StandardMidiFile *_file;
+    TrackCursor _tracks[MaxTracks];
+    uint8_t _heap[MaxTracks];
+    size_t _heapSize;
+    MidiEvent _batch[BatchLength];
+    size_t _batchCount;
+
+    float _sampleRate;
+    uint64_t _blockStart;
+    uint64_t _tempoTick;
+    double _tempoSample;
+    double _samplesPerTick;
+    uint32_t _tempo;
+
+    /// @brief variable length quantity, at most 4 bytes
+    static inline uint32_t readVariable(const uint8_t *&p, const uint8_t *end)
+    {
+      uint32_t value = 0;
+      for (int i = 0; i < 4 && p < end; i++)
+      {
+        const uint8_t b = *p++;
+        value = (value << 7) | (b & 0x7F);
+        if (!(b & 0x80))
+        {
+          break;
+        }
+      }
+      return value;
+    }
+
+    inline bool before(uint8_t a, uint8_t b) const
+    {
+      // equal ticks keep track order, so tempo changes in track 0 come first
+      return _tracks[a].tick < _tracks[b].tick || (_tracks[a].tick == _tracks[b].tick && a < b);
+    }
+
+    void siftDown(size_t i)
+    {
+      for (;;)
+      {
+        size_t smallest = i;
+        const size_t left = 2 * i + 1;
+        const size_t right = left + 1;
+        if (left < _heapSize && before(_heap[left], _heap[smallest]))
+        {
+          smallest = left;
+        }
+        if (right < _heapSize && before(_heap[right], _heap[smallest]))
+        {
+          smallest = right;
+        }
+        if (smallest == i)
+        {
+          return;
+        }
+        const uint8_t t = _heap[i];
+        _heap[i] = _heap[smallest];
+        _heap[smallest] = t;
+        i = smallest;
+      }
+    }
+
+    void updateSamplesPerTick()
+    {
+      const uint16_t division = _file->division();
+      if (division & 0x8000)
+      {
+        const int8_t fps = (int8_t)(division >> 8);
+        const double framesPerSecond = fps == -29 ? 29.97 : (double)-fps;
+        _samplesPerTick = (double)_sampleRate / (framesPerSecond * (double)(division & 0xFF));
+      }
+      else
+      {
+        _samplesPerTick = (double)_tempo * 1e-6 * (double)_sampleRate / (double)division;
+      }
+    }
+
+    inline double sampleOf(uint64_t tick) const { return _tempoSample + (double)(tick - _tempoTick) * _samplesPerTick; }
+
+    template <class Handler>
+    inline void flush(Handler &handler)
+    {
+      if (_batchCount > 0)
+      {
+        handler.onEvents(_batch, _batchCount);
+        _batchCount = 0;
+      }
+    }
+
+    /*
+     * decodes the pending event of a track and reads the delta time of the one after it,
+     * returns false at the end of the track
+     */
+    template <class Handler>
+    bool step(TrackCursor &track, uint32_t timestamp, Handler &handler)
+    {
+      const uint8_t *&p = track.position;
+      if (p >= track.end)
+      {
+        return false;
+      }
+      uint8_t status = *p;
+      if (status & 0x80)
+      {
+        p++;
+      }
+      else
+      {
+        status = track.runningStatus;
+      }
+
+      if (status == 0xFF)
+      {
+        track.runningStatus = 0;
+        if (p >= track.end)
+        {
+          return false;
+        }
+        const uint8_t type = *p++;
+        const uint32_t length = readVariable(p, track.end);
+        if (type == 0x2F || length > (size_t)(track.end - p))
+        {
+          return false;
+        }
+        if (type == 0x51 && length == 3)
+        {
+          _tempoSample = sampleOf(track.tick);
+          _tempoTick = track.tick;
+          _tempo = ((uint32_t)p[0] << 16) | ((uint32_t)p[1] << 8) | p[2];
+          updateSamplesPerTick();
+        }
+        p += length;
+      }
+      else if (status == 0xF0 || status == 0xF7)
+      {
+        track.runningStatus = 0;
+        const uint32_t length = readVariable(p, track.end);
+        if (length > (size_t)(track.end - p))
+        {
+          return false;
+        }
+        const bool last = length > 0 && p[length - 1] == 0xF7;
+        flush(handler);
+        SysExChunk chunk;
+        chunk.data = p;
+        chunk.length = last ? length - 1 : length;
+        chunk.timestamp = timestamp;
+        chunk.first = status == 0xF0;
+        chunk.last = last;
+        chunk.aborted = false;
+        handler.onSysEx(chunk);
+        p += length;
+      }
+      else if (status >= 0x80)
+      {
+        if (status < 0xF0)
+        {
+          track.runningStatus = status;
+        }
+        const uint8_t length = MidiEvent::dataLength(status);
+        if (length > (size_t)(track.end - p))
+        {
+          return false;
+        }
+        MidiEvent &event = _batch[_batchCount++];
+        event.timestamp = timestamp;
+        event.status = status;
+        event.data1 = length > 0 ? p[0] : 0;
+        event.data2 = length > 1 ? p[1] : 0;
+        event.length = length;
+        p += length;
+        if (_batchCount == BatchLength)
+        {
+          flush(handler);
+        }
+      }
+      else
+      {
+        // data byte without running status, the track is corrupt
+        return false;
+      }
+
+      if (p >= track.end)
+      {
+        return false;
+      }
+      track.tick += readVariable(p, track.end);
+      return true;
+    }
+
+  public:
+    StandardMidiFilePlayer(float sampleRate) : _file(nullptr), _heapSize(0), _batchCount(0), _sampleRate(sampleRate)
+    {
+    }
+
+    /// @brief the file has to outlive the player, returns false if it has more than MaxTracks tracks
+    bool load(const StandardMidiFile &file)
+    {
+      _file = &file;
+      return rewind();
+    }
+
+    bool rewind()
+    {
+      _heapSize = 0;
+      _batchCount = 0;
+      _blockStart = 0;
+      _tempoTick = 0;
+      _tempoSample = 0.0;
+      _tempo = 500000;
+      if (_file == nullptr || !_file->valid())
+      {
+        return false;
+      }
+      updateSamplesPerTick();
+      const size_t count = _file->trackCount();
+      for (size_t i = 0; i < count && i < MaxTracks; i++)
+      {
+        const uint8_t *data;
+        size_t length;
+        if (!_file->track(i, data, length) || length == 0)
+        {
+          continue;
+        }
+        TrackCursor &track = _tracks[i];
+        track.position = data;
+        track.end = data + length;
+        track.runningStatus = 0;
+        track.tick = readVariable(track.position, track.end);
+        _heap[_heapSize++] = (uint8_t)i;
+      }
+      for (size_t i = _heapSize / 2; i-- > 0;)
+      {
+        siftDown(i);
+      }
+      return count <= MaxTracks;
+    }
+
+    /// @brief emits the events of the next samples samples, returns false once the file has ended
+    /// @param sampleTime engine sample time of the first of those samples
+    template <class Handler>
+    bool render(uint32_t samples, Handler &handler, uint32_t sampleTime)
+    {
+      const uint64_t blockEnd = _blockStart + samples;
+      while (_heapSize > 0)
+      {
+        TrackCursor &track = _tracks[_heap[0]];
+        const double at = sampleOf(track.tick);
+        if (at >= (double)blockEnd)
+        {
+          break;
+        }
+        const double offset = at - (double)_blockStart;
+        if (step(track, sampleTime + (offset > 0.0 ? (uint32_t)offset : 0), handler))
+        {
+          siftDown(0);
+        }
+        else
+        {
+          _heap[0] = _heap[--_heapSize];
+          siftDown(0);
+        }
+      }
+      flush(handler);
+      _blockStart = blockEnd;
+      return _heapSize > 0;
+    }
+
+    inline bool finished() const { return _heapSize == 0; }
+    inline uint64_t samplePosition() const { return _blockStart; }
+    /// @brief current tempo, also for SMPTE files where it has no effect on timing
+    inline float bpm() const { return 60000000.0f / (float)_tempo; }
+  };
+
+}
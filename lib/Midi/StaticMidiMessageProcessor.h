@@ -0,0 +1,60 @@
+#pragma once
+#include <stdint.h>
+#include <cstddef>
+#include "MidiEvent.h"
+#include "MidiMessages.h"
+#include "MidiDispatcher.h"
+#include "SysEx.h"
+
+namespace Midi
+{
+
+    /// @brief Statically dispatched counterpart of MidiMessageProcessor for code running inside the audio callback.
+    /// Derived hides the Handle* methods it cares about (same names and signatures as MidiMessageProcessor);
+    /// the rest resolve to the empty inline defaults below and compile away. Handlers must be public,
+    /// or Derived befriends MidiDispatcher.
+    ///
+    /// process(events, count) takes a batch as drained from a MidiEventQueue, and onEvents / onSysEx
+    /// let the processor be handed to MidiStreamParser::parse directly.
+    template <class Derived>
+    class StaticMidiMessageProcessor
+    {
+    public:
+        inline void HandleNoteOff(Messages::NoteOff &msg) {}
+        inline void HandleNoteOn(Messages::NoteOn &msg) {}
+        inline void HandlePolyphonicKeyPressure(Messages::PolyphonicKeyPressure &msg) {}
+        inline void HandleControlChange(Messages::ControlChange &msg) {}
+        inline void HandleProgramChange(Messages::ProgramChange &msg) {}
+        inline void HandleChannelPressure(Messages::ChannelPressure &msg) {}
+        inline void HandlePitchBendChange(Messages::PitchBendChange &msg) {}
+        inline void HandleTimeCodeQuarterFrame(Messages::TimeCodeQuarterFrame &msg) {}
+        inline void HandleSongPositionPointer(Messages::SongPositionPointer &msg) {}
+        inline void HandleSongSelect(Messages::SongSelect &msg) {}
+        inline void HandleTuneRequest(Messages::TuneRequest &msg) {}
+        inline void HandleEndofExclusive(Messages::EndofExclusive &msg) {}
+        inline void HandleTimingClock(Messages::TimingClock &msg) {}
+        inline void HandleStart(Messages::Start &msg) {}
+        inline void HandleContinue(Messages::Continue &msg) {}
+        inline void HandleStop(Messages::Stop &msg) {}
+        inline void HandleActiveSensing(Messages::ActiveSensing &msg) {}
+        inline void HandleReset(Messages::Reset &msg) {}
+        inline void HandleSystemExclusive(const SysExChunk &chunk) {}
+
+        inline void process(const MidiEvent &event)
+        {
+            MidiDispatcher::dispatch(event, *static_cast<Derived *>(this));
+        }
+
+        void process(const MidiEvent *events, size_t count)
+        {
+            for (size_t i = 0; i < count; i++)
+            {
+                process(events[i]);
+            }
+        }
+
+        inline void onEvents(const MidiEvent *events, size_t count) { process(events, count); }
+        inline void onSysEx(const SysExChunk &chunk) { static_cast<Derived *>(this)->HandleSystemExclusive(chunk); }
+    };
+
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include <stdint.h>
+#include <cstddef>
+#include <string.h>
+
+namespace Midi
+{
+
+  /// @brief Part of a System Exclusive message, the payload between 0xF0 and 0xF7 (both excluded).
+  /// data points into the buffer the bytes were received in and is only valid during the call it is passed to.
+  /// Large dumps, dumps spread over several transport buffers and dumps interrupted by realtime bytes
+  /// arrive as several chunks; first marks the chunk that starts a message, last the one that ends it.
+  /// A message cut off by another status byte instead of 0xF7 ends with a chunk that has both last and aborted set.
+  struct SysExChunk
+  {
+    const uint8_t *data;
+    size_t length;
+    uint32_t timestamp;
+    bool first;
+    bool last;
+    bool aborted;
+
+    /// @brief the manufacturer id byte, valid on the first chunk when length > 0
+    inline uint8_t manufacturer() const { return data[0]; }
+  };
+
+  /// @brief Preallocated buffer for receivers that need a whole message in one piece
+  /// while the transport reuses its receive buffer. Messages that do not fit or were aborted are discarded.
+  template <size_t Capacity = 1024>
+  class SysExArena
+  {
+  private:
+    uint8_t _data[Capacity];
+    size_t _length;
+    bool _overflow;
+    bool _complete;
+
+  public:
+    SysExArena() : _length(0), _overflow(false), _complete(false) {}
+
+    /// @brief collects a chunk, returns true once a complete message is available
+    bool append(const SysExChunk &chunk)
+    {
+      if (chunk.first)
+      {
+        clear();
+      }
+      if (_length + chunk.length > Capacity)
+      {
+        _overflow = true;
+      }
+      else
+      {
+        memcpy(_data + _length, chunk.data, chunk.length);
+        _length += chunk.length;
+      }
+      _complete = chunk.last && !chunk.aborted && !_overflow;
+      return _complete;
+    }
+
+    void clear()
+    {
+      _length = 0;
+      _overflow = false;
+      _complete = false;
+    }
+
+    inline const uint8_t *data() const { return _data; }
+    inline size_t length() const { return _length; }
+    inline bool complete() const { return _complete; }
+    inline bool overflow() const { return _overflow; }
+    inline size_t capacity() const { return Capacity; }
+  };
+
+}
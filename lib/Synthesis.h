@@ -2,13 +2,17 @@
 #include "Synthesis/AllPass.h"
 #include "Synthesis/Comb.h"
 #include "Synthesis/Delay.h"
+#include "Synthesis/DelayLinePolicies.h"
 #include "Synthesis/Envelope.h"
+#include "Synthesis/Fft.h"
 #include "Synthesis/Filter.h"
 #include "Synthesis/LowFrequencyOscillator.h"
 #include "Synthesis/Oscilator.h"
+#include "Synthesis/PhaseVocoder.h"
 #include "Synthesis/Phaser.h"
 #include "Synthesis/PitchShifter.h"
 #include "Synthesis/Reverb.h"
+#include "Synthesis/RotarySpeaker.h"
 #include "Synthesis/SampleBuffer.h"
 #include "Synthesis/SignalTransformation.h"
 #include "Synthesis/Tremolo.h"
@@ -43,48 +43,74 @@
 #include <stdint.h>
 #include "SampleBuffer.h"
 #include "SignalTransformation.h"
+#include "DelayLinePolicies.h"
 namespace Synthesis
 {
-    template <size_t BufferLength = 48>
+    /**
+     * Schroeder all-pass over a DelayLength delay line, processing blocks of BufferLength.
+     * Wrapping and length modulation come from the Policy type so the sample loop inlines
+     * completely, see DelayLinePolicies.h.
+     */
+    template <size_t DelayLength, typename Policy = DelayLinePolicies::WrapToStart, size_t BufferLength = 48>
     class AllPass : public SignalTransformation
     {
     protected:
-        StaticSampleBuffer<BufferLength> _buff;
+        StaticSampleBuffer<DelayLength> _buff;
         uint32_t _p;
         float _g;
         uint32_t _lim;
-        virtual void updateWorkingCopy(size_t index, uint32_t &p, float &g, uint32_t &lim) = 0;
+        Policy _policy;
+
+        inline float step(uint32_t p, float g, float input)
+        {
+            float readback = _buff[p];
+            readback += (-g) * input;
+            const float newV = readback * g + input;
+            _buff[p] = newV;
+            return readback;
+        }
 
     public:
-        AllPass() : _p(0.0f), _g(0.00025f) {}
-        AllPass(uint32_t p, uint32_t g, uint32_t lim) : _p(p), _g(g), _lim(lim) {}
+        AllPass() : _p(0), _g(0.00025f), _lim(DelayLength) {}
+        AllPass(uint32_t p, float g, uint32_t lim) : _p(p), _g(g), _lim(lim > DelayLength ? DelayLength : lim) {}
 
         virtual void process(const SampleBuffer &inputSignal, SampleBuffer &outputSignal) override
         {
-            uint32_t copy_p;
-            float copy_g;
-            uint32_t copy_lim;
+            /* working copies stay in registers for the whole block */
+            uint32_t copy_p = _p;
+            const float copy_g = _g;
+            const uint32_t copy_lim = _lim;
 
-            for (int n = 0; n < BufferLength; n++)
+            if (!Policy::IsModulated && copy_p + BufferLength < copy_lim)
+            {
+                /* the block cannot reach the end of the loop, no wrap check needed */
+                for (size_t n = 0; n < BufferLength; n++)
+                {
+                    outputSignal[n] = step(copy_p + n, copy_g, inputSignal[n]);
+                }
+                copy_p += BufferLength;
+            }
+            else
             {
-                float readback = _buff[copy_p];
-                readback += (-copy_g) * inputSignal[n];
-                const float newV = readback * copy_g + inputSignal[n];
-                _buff[copy_p] = newV;
-                copy_p++;
-                updateWorkingCopy(n, copy_p, copy_g, copy_lim);
-                outputSignal[n] = readback;
+                for (size_t n = 0; n < BufferLength; n++)
+                {
+                    const float readback = step(copy_p, copy_g, inputSignal[n]);
+                    copy_p++;
+                    Policy::wrap(copy_p, _policy.limit(n, copy_lim));
+                    outputSignal[n] = readback;
+                }
             }
             _p = copy_p;
-            _g = copy_g;
-            _lim = copy_lim;
         }
-        virtual void reset()
+        virtual void reset() override
         {
+            _buff.clear();
+            _p = 0;
         }
         void setG(float value)
         {
             _g = value;
         }
+        inline Policy &policy() { return _policy; }
     };
-}
\ No newline at end of file
+}
@@ -43,44 +43,71 @@
 #include <stdint.h>
 #include "SampleBuffer.h"
 #include "SignalTransformation.h"
+#include "DelayLinePolicies.h"
 namespace Synthesis
 {
-    template <size_t CombBufferLength>
+    /**
+     * Feedback comb over a CombBufferLength delay line, adds its output to outputSample
+     * so several combs can share one destination. Wrapping comes from the Policy type,
+     * see DelayLinePolicies.h.
+     */
+    template <size_t CombBufferLength, typename Policy = DelayLinePolicies::WrapToStart, size_t BufferLength = 48>
     class Comb : public SignalTransformation
     {
     private:
         StaticSampleBuffer<CombBufferLength> _buffer;
-        int _p;
+        uint32_t _p;
         float _g;
-        int _lim;
+        uint32_t _lim;
+        Policy _policy;
+
+        inline float step(uint32_t p, float g, float input)
+        {
+            const float readback = _buffer[p];
+            const float newV = readback * g + input;
+            _buffer[p] = newV;
+            return readback;
+        }
 
     public:
-        Comb(int p, float g, int lim) : _p(p),
-                                        _g(g),
-                                        _lim(lim)
+        Comb(uint32_t p, float g, uint32_t lim) : _p(p),
+                                                  _g(g),
+                                                  _lim(lim > CombBufferLength ? CombBufferLength : lim)
         {
         }
-        virtual void process(const SampleBuffer &inputSignal, SampleBuffer &outputSignal) override
+        virtual void process(const SampleBuffer &inputSample, SampleBuffer &outputSample) override
         {
-            int copy_p = _p;
-            float copy_g = _g;
-            int copy_lim = _lim;
-            for (int n = 0; n < CombBufferLength; n++)
+            /* working copies stay in registers for the whole block */
+            uint32_t copy_p = _p;
+            const float copy_g = _g;
+            const uint32_t copy_lim = _lim;
+
+            if (!Policy::IsModulated && copy_p + BufferLength < copy_lim)
+            {
+                /* the block cannot reach the end of the loop, no wrap check needed */
+                for (size_t n = 0; n < BufferLength; n++)
+                {
+                    outputSample[n] += step(copy_p + n, copy_g, inputSample[n]);
+                }
+                copy_p += BufferLength;
+            }
+            else
             {
-                const float readback = _buffer[copy_p];
-                const float newV = readback * copy_g + inputSample[n];
-                _buffer[copy_p] = newV;
-                copy_p++;
-                if (copy_p >= copy_lim)
+                for (size_t n = 0; n < BufferLength; n++)
                 {
-                    copy_p = 0;
+                    const float readback = step(copy_p, copy_g, inputSample[n]);
+                    copy_p++;
+                    Policy::wrap(copy_p, _policy.limit(n, copy_lim));
+                    outputSample[n] += readback;
                 }
-                outputSample[n] += readback;
             }
             _p = copy_p;
-            _g = copy_g;
-            _lim = copy_lim;
         }
-        virtual void reset() {}
+        virtual void reset() override
+        {
+            _buffer.clear();
+            _p = 0;
+        }
+        inline Policy &policy() { return _policy; }
     };
 }
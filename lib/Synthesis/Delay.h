@@ -43,6 +43,7 @@
 
 #include <math.h>
 #include "SignalTransformation.h"
+#include "../Midi/MidiClock.h"
 
 namespace Synthesis
 {
@@ -60,13 +61,90 @@ namespace Synthesis
         uint32_t _delayOut = 0;
         uint32_t _delayOut2 = 0;
         uint32_t _delayOut3 = 0;
+        Midi::MidiClock *_clock = nullptr;
+        float _syncBeats = 0.0f;
+        float _syncedLength = 0.0f;
+        float _smoothedLength = 0.0f;
+
+        /*
+         * the clock's tempo estimate wanders by a few samples per beat while it settles,
+         * changes below this many samples are ignored
+         */
+        const float SyncHysteresis = 2.0f;
+        /*
+         * per sample step of the read position towards a new length (about 20 ms),
+         * a tape-like pitch glide instead of a jump in the signal
+         */
+        const float SyncSlew = 0.001f;
+
+        /*
+         * follow the clock's smoothed tempo once per block
+         */
+        void updateSyncedLength()
+        {
+            float length = _syncBeats * _clock->samplesPerBeat();
+            const float bufferLength = (float)_buffer.length();
+            if (length > bufferLength)
+            {
+                length = bufferLength;
+            }
+            if (length < 1.0f)
+            {
+                length = 1.0f;
+            }
+            if (fabsf(length - _syncedLength) > SyncHysteresis)
+            {
+                _syncedLength = length;
+            }
+        }
+
+        /*
+         * synced path: the read position glides to the clock's length and is read between samples
+         */
+        void processSynced(const SampleBuffer &inputSignal, SampleBuffer &outputSignal)
+        {
+            auto signalLength = inputSignal.length();
+            auto bufferLength = _buffer.length();
+            for (size_t n = 0; n < signalLength; n++)
+            {
+                _smoothedLength += (_syncedLength - _smoothedLength) * SyncSlew;
+                _buffer[_delayIn] = (((float)0x4000) * inputSignal[n] * _inputLevel);
+
+                float position = (float)_delayIn + 1.0f + (float)bufferLength - _smoothedLength;
+                if (position >= (float)bufferLength)
+                {
+                    position -= (float)bufferLength;
+                }
+                uint32_t index = (uint32_t)position;
+                const float fraction = position - (float)index;
+                uint32_t next = index + 1;
+                if (next >= bufferLength)
+                {
+                    next = 0;
+                }
+                _delayOut = index;
+                const float delayed = _buffer[index] + (_buffer[next] - _buffer[index]) * fraction;
+
+                outputSignal[n] += delayed * _outputLevel / ((float)0x4000);
+
+                _buffer[_delayIn] += delayed * _delayFeedback;
+
+                _delayIn++;
+
+                if (_delayIn >= bufferLength)
+                {
+                    _delayIn = 0;
+                }
+            }
+            _delayLength = (uint32_t)(_smoothedLength + 0.5f);
+        }
 
     public:
-        const uint32_t DefaultDelayLength = 11098;
-        const float DefaultInputLevel = 1.0f;
-        const float DefaultOutputLevel = 0.0f;
-        const float DefaultFeedback = 0.0f;
-        const float DefaultShift = 2.0f / 3.0f;
+        static constexpr uint32_t DefaultDelayLength = 11098;
+        static constexpr float DefaultInputLevel = 1.0f;
+        static constexpr float DefaultOutputLevel = 0.0f;
+        static constexpr float DefaultFeedback = 0.0f;
+        static constexpr float DefaultShift = 2.0f / 3.0f;
 
         Delay()
             : Delay(DefaultDelayLength, DefaultInputLevel, DefaultOutputLevel, DefaultFeedback, DefaultShift)
@@ -78,7 +156,7 @@ namespace Synthesis
                                                                                                         _delayFeedback(feedback),
                                                                                                         _shift(shift)
         {
-            auto bufferLength = buffer.length();
+            auto bufferLength = _buffer.length();
 
             if (_delayLength > bufferLength)
             {
@@ -97,6 +175,12 @@ namespace Synthesis
 
         virtual void process(const SampleBuffer &inputSignal, SampleBuffer &outputSignal) override
         {
+            if (_clock != nullptr)
+            {
+                updateSyncedLength();
+                processSynced(inputSignal, outputSignal);
+                return;
+            }
             auto signalLength = inputSignal.length();
             auto bufferLength = _buffer.length();
             for (int n = 0; n < signalLength; n++)
@@ -162,5 +246,23 @@ namespace Synthesis
             _delayLength = newValue;
             return oldValue;
         }
+
+        /**
+         * Locks the delay time to MIDI clock, e.g. 0.75 for a dotted eighth.
+         * The length is limited to the delay buffer, tempo changes glide it over about 20 ms.
+         */
+        void syncTo(Midi::MidiClock &clock, float beats)
+        {
+            _clock = &clock;
+            _syncBeats = beats;
+            // glide from the current length
+            _syncedLength = (float)_delayLength;
+            _smoothedLength = (float)_delayLength;
+        }
+
+        void unsync()
+        {
+            _clock = nullptr;
+        }
     };
 }
\ No newline at end of file
@@ -0,0 +1,36 @@
+/**
+ * @file DelayLinePolicies.h
+ *
+ * @brief Compile-time wrap policies for the AllPass and Comb delay lines
+ *
+ * A policy provides IsModulated (false lets blocks that cannot reach the limit skip the wrap check),
+ * limit() for the loop length at a sample of the block and wrap() for the read/write position.
+ */
+
+#pragma once
+#include <cstddef>
+#include <stdint.h>
+#include "SampleBuffer.h"
+
+namespace Synthesis
+{
+    namespace DelayLinePolicies
+    {
+        /**
+         * Fixed loop length, the read/write position restarts at 0 when it reaches the limit.
+         * Blocks that cannot reach the limit skip the wrap check entirely.
+         */
+        struct WrapToStart
+        {
+            static const bool IsModulated = false;
+            inline uint32_t limit(size_t index, uint32_t lim) { return lim; }
+            static inline void wrap(uint32_t &p, uint32_t lim)
+            {
+                if (p >= lim)
+                {
+                    p = 0;
+                }
+            }
+        };
+    }
+}
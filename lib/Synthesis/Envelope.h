@@ -66,101 +66,114 @@ namespace Synthesis
         AdsrEnvelope(float attack, float decay, float sustain, float release) : _attack(attack),
                                                                                 _decay(decay),
                                                                                 _sustain(sustain),
-                                                                                _release(release)
+                                                                                _release(release),
+                                                                                _w(1.0f),
+                                                                                _sample_rate(0.0f),
+                                                                                _ctrl(0.0f),
+                                                                                _phase(EnvelopePhase::release)
         {
         }
+        virtual ~AdsrEnvelope() {}
+
         /*
          * very bad and simple implementation of ADSR
          * - but it works for the start
+         *
+         * the envelope state is passed in so a voice pool can keep it per voice,
+         * returns false once the release is over
          */
-        virtual bool process(/*const struct adsrT *ctrl, struct adsr_t *adsr*/)
+        static inline bool step(float attack, float decay, float sustain, float release, float &ctrl, EnvelopePhase &phase)
         {
-            switch (_phase)
+            switch (phase)
             {
             case EnvelopePhase::attack:
-                _ctrl += _attack;
-                if (_ctrl > 1.0f)
+                ctrl += attack;
+                if (ctrl > 1.0f)
                 {
-                    _ctrl = 1.0f;
-                    _phase = EnvelopePhase::decay;
+                    ctrl = 1.0f;
+                    phase = EnvelopePhase::decay;
                 }
                 break;
             case EnvelopePhase::decay:
-                _ctrl -= _decay;
-                if (_ctrl < _sustain)
+                ctrl -= decay;
+                if (ctrl < sustain)
                 {
-                    _ctrl = _sustain;
-                    _phase = EnvelopePhase::sustain;
+                    ctrl = sustain;
+                    phase = EnvelopePhase::sustain;
                 }
                 break;
             case EnvelopePhase::sustain:
                 break;
             case EnvelopePhase::release:
-                _ctrl -= _release;
-                if (_ctrl < 0.0f)
+                ctrl -= release;
+                if (ctrl < 0.0f)
                 {
-                    _ctrl = 0.0f;
+                    ctrl = 0.0f;
                     return false;
                 }
             }
             return true;
         }
 
-        void start(const struct adsrT *ctrl, struct adsr_t *adsr)
+        static inline void start(float attack, float &ctrl, EnvelopePhase &phase)
         {
-            _ctrl = _attack;
-            if (_attack == 1.0f) /* not sure if that check is necessary */
+            ctrl = attack;
+            if (attack == 1.0f) /* not sure if that check is necessary */
             {
-                _phase = EnvelopePhase::decay;
+                phase = EnvelopePhase::decay;
             }
             else
             {
-                _phase = EnvelopePhase::attack;
+                phase = EnvelopePhase::attack;
             }
         }
+
+        virtual bool process()
+        {
+            return step(_attack, _decay, _sustain, _release, _ctrl, _phase);
+        }
+
+        void start()
+        {
+            start(_attack, _ctrl, _phase);
+        }
+
+        inline void stop() { _phase = EnvelopePhase::release; }
+
+        inline float getAttack() const { return _attack; }
+        inline void setAttack(float value) { _attack = value; }
+        inline float getDecay() const { return _decay; }
+        inline void setDecay(float value) { _decay = value; }
+        inline float getSustain() const { return _sustain; }
+        inline void setSustain(float value) { _sustain = value; }
+        inline float getRelease() const { return _release; }
+        inline void setRelease(float value) { _release = value; }
+        /* depth the envelope is applied with, e.g. pitch or morph amount */
+        inline float getWeight() const { return _w; }
+        inline void setWeight(float value) { _w = value; }
+        inline float getCtrl() const { return _ctrl; }
+        inline EnvelopePhase getPhase() const { return _phase; }
     };
 
+    /*
+     * attack, decay to zero, release; the sustain value is the modulation depth
+     */
     class AsmrEnvelope : public AdsrEnvelope
     {
 
     public:
-        AsmrEnvelope(float attack, float decay, float sustain, float release) : _attack(attack),
-                                                                                _decay(decay),
-                                                                                _sustain(sustain),
-                                                                                _release(release)
+        AsmrEnvelope(float attack, float decay, float sustain, float release) : AdsrEnvelope(attack, decay, sustain, release)
+        {
+        }
+
+        static inline bool step(float attack, float decay, float release, float &ctrl, EnvelopePhase &phase)
         {
+            return AdsrEnvelope::step(attack, decay, 0.0f, release, ctrl, phase);
         }
+
         virtual bool process() override
         {
-            switch (_phase)
-            {
-            case EnvelopePhase::attack:
-                _ctrl += _attack;
-                if (_ctrl > 1.0f)
-                {
-                    _ctrl = 1.0f;
-                    _phase = EnvelopePhase::decay;
-                }
-                break;
-            case EnvelopePhase::decay:
-                _ctrl -= _decay;
-                if (_ctrl < 0)
-                {
-                    _ctrl = 0;
-                    _phase = EnvelopePhase::sustain;
-                }
-                break;
-            case EnvelopePhase::sustain:
-                break;
-            case EnvelopePhase::release:
-                _ctrl -= _release;
-                if (_ctrl < 0.0f)
-                {
-                    _ctrl = 0.0f;
-                    return false;
-                }
-            }
-            return true;
+            return step(_attack, _decay, _release, _ctrl, _phase);
         }
     };
 
@@ -0,0 +1,111 @@
+/**
+ * @file Fft.h
+ *
+ * @brief In-place radix-2 complex FFT with preallocated twiddle and bit reversal tables
+ */
+
+#pragma once
+#include <cstddef>
+#include <stdint.h>
+#include <math.h>
+
+namespace Synthesis
+{
+    /**
+     * MaxLength must be a power of two. The transform length can be lowered at runtime
+     * with setLength(); the twiddles for MaxLength are reused with a stride so nothing
+     * is recomputed or allocated on the audio path.
+     */
+    template <size_t MaxLength = 1024>
+    class Fft
+    {
+    private:
+        float _cos[MaxLength / 2];
+        float _sin[MaxLength / 2];
+        uint16_t _bitReverse[MaxLength];
+        size_t _length;
+
+        void transform(float *re, float *im, float direction)
+        {
+            for (size_t i = 0; i < _length; i++)
+            {
+                const size_t j = _bitReverse[i];
+                if (j > i)
+                {
+                    float t = re[i];
+                    re[i] = re[j];
+                    re[j] = t;
+                    t = im[i];
+                    im[i] = im[j];
+                    im[j] = t;
+                }
+            }
+
+            for (size_t size = 2; size <= _length; size <<= 1)
+            {
+                const size_t half = size >> 1;
+                const size_t stride = MaxLength / size;
+                for (size_t start = 0; start < _length; start += size)
+                {
+                    for (size_t k = 0; k < half; k++)
+                    {
+                        const float wr = _cos[k * stride];
+                        const float wi = direction * _sin[k * stride];
+                        const size_t a = start + k;
+                        const size_t b = a + half;
+                        const float tr = re[b] * wr - im[b] * wi;
+                        const float ti = re[b] * wi + im[b] * wr;
+                        re[b] = re[a] - tr;
+                        im[b] = im[a] - ti;
+                        re[a] += tr;
+                        im[a] += ti;
+                    }
+                }
+            }
+        }
+
+    public:
+        Fft()
+        {
+            for (size_t k = 0; k < MaxLength / 2; k++)
+            {
+                _cos[k] = cosf(2.0f * M_PI * k / MaxLength);
+                _sin[k] = sinf(2.0f * M_PI * k / MaxLength);
+            }
+            setLength(MaxLength);
+        }
+
+        /**
+         * @param length power of two, at most MaxLength
+         */
+        void setLength(size_t length)
+        {
+            if (length > MaxLength)
+            {
+                length = MaxLength;
+            }
+            _length = length;
+            size_t bits = 0;
+            while (((size_t)1 << bits) < _length)
+            {
+                bits++;
+            }
+            for (size_t i = 0; i < _length; i++)
+            {
+                size_t reversed = 0;
+                for (size_t b = 0; b < bits; b++)
+                {
+                    reversed |= ((i >> b) & 1) << (bits - 1 - b);
+                }
+                _bitReverse[i] = (uint16_t)reversed;
+            }
+        }
+        inline size_t length() { return _length; }
+
+        inline void forward(float *re, float *im) { transform(re, im, -1.0f); }
+        /*
+         * not scaled by 1/length
+         */
+        inline void inverse(float *re, float *im) { transform(re, im, 1.0f); }
+    };
+}
@@ -42,6 +42,7 @@
 
 #pragma once
 #include <cstddef>
+#include <stdint.h>
 #include "SampleBuffer.h"
 #include "WaveForms.h"
 #include <math.h>
@@ -55,13 +56,16 @@ namespace Synthesis
         float _aNorm[2];
 
     public:
-        inline float aNorm(uint8_t idx) { return _aNorm[idx]; }
-        inline float bNorm(uint8_t idx) { return _bNorm[idx]; }
+        inline float aNorm(uint8_t idx) const { return _aNorm[idx]; }
+        inline float bNorm(uint8_t idx) const { return _bNorm[idx]; }
     };
 
     class LowPassFilterCoefficent : public FilterCoefficent
     {
     public:
+        /*
+         * c is the cutoff 0..1, reso the Q, sine the table the cos / sin lookups are made from
+         */
         LowPassFilterCoefficent(float c, float reso, WaveForms::WaveForm *sine)
         {
             /*
@@ -173,9 +177,29 @@ namespace Synthesis
     class Filter : public SignalTransformation
     {
     protected:
-        FilterCoefficent &_coefficent float _w[2];
+        const FilterCoefficent *_coefficent;
+        float _w[2];
 
     public:
+        Filter(const FilterCoefficent &coefficent) : _coefficent(&coefficent)
+        {
+            reset();
+        }
+
+        /*
+         * one sample through the 2nd order IIR filter, w is the filter state;
+         * lets a voice pool run the filter on state it keeps per voice
+         */
+        static inline float step(const FilterCoefficent &coefficent, float *w, float in)
+        {
+            const float out = coefficent.bNorm(0) * in + w[0];
+            w[0] = coefficent.bNorm(1) * in - coefficent.aNorm(0) * out + w[1];
+            w[1] = coefficent.bNorm(2) * in - coefficent.aNorm(1) * out;
+            return out;
+        }
+
+        inline void setCoefficent(const FilterCoefficent &coefficent) { _coefficent = &coefficent; }
+
         virtual void reset() override
         {
             _w[0] = 0.0;
@@ -187,10 +211,7 @@ namespace Synthesis
 
             for (size_t n = 0; n < BufferLength; n++)
             {
-                const float out = _coeffcient.bNorm(0) * inputSignal[n] + _w[0];
-                _w[0] = _coeffcient.bNorm(1) * inputSignal[n] - _coeffcient.aNorm(0) * out + _w[1];
-                _w[1] = _coeffcient.bNorm(2) * inputSignal[n] - _coeffcient.aNorm(1) * out;
-                outputSignal[n] = out;
+                outputSignal[n] = step(*_coefficent, _w, inputSignal[n]);
             }
         }
     };
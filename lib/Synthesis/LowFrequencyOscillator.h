@@ -43,6 +43,7 @@
 #include <stdint.h>
 #include "SampleBuffer.h"
 #include "SignalTransformation.h"
+#include "../Midi/MidiClock.h"
 #include "math.h"
 namespace Synthesis
 {
@@ -53,9 +54,31 @@ namespace Synthesis
         float _sample_rate;
         float _frequency;
         float _phase;
+        Midi::MidiClock *_clock;
+        float _beatsPerCycle;
+
+        /*
+         * phase is taken from the clock at the start of the block and advanced at the
+         * clock's tempo, so the oscillator stays locked without an outside control loop
+         */
+        void processSynced(SampleBuffer &outputSignal)
+        {
+            const float cyclesPerSample = 1.0f / (_beatsPerCycle * _clock->samplesPerBeat());
+            float cycle = _clock->cyclePosition(_beatsPerCycle);
+            for (size_t n = 0; n < BufferLength; n++)
+            {
+                outputSignal[n] = sinf(2.0f * M_PI * cycle);
+                cycle += cyclesPerSample;
+                if (cycle >= 1.0f)
+                {
+                    cycle -= 1.0f;
+                }
+            }
+            _phase = 2.0f * M_PI * cycle;
+        }
 
     public:
-        LowFrequencyOscillator(float sample_rate) : _sample_rate(sample_rate), _phase(0.0f), _frequency(1.0f)
+        LowFrequencyOscillator(float sample_rate) : _sample_rate(sample_rate), _phase(0.0f), _frequency(1.0f), _clock(nullptr), _beatsPerCycle(1.0f)
         {
         }
         virtual void reset() override
@@ -65,6 +88,11 @@ namespace Synthesis
         }
         virtual void process(const SampleBuffer &inputSignal, SampleBuffer &outputSignal) override
         {
+            if (_clock != nullptr && _clock->isRunning() && _beatsPerCycle > 0.0f)
+            {
+                processSynced(outputSignal);
+                return;
+            }
             for (size_t n = 0; n < BufferLength; n++)
             {
                 const float omega = inputSignal[n] * 2.0f * M_PI / (_sample_rate);
@@ -87,5 +115,25 @@ namespace Synthesis
         {
             this->_phase = phase;
         }
+
+        /**
+         * Locks the oscillator to MIDI clock, one cycle every beatsPerCycle quarter notes.
+         * While the clock is stopped the oscillator free-runs from its last phase.
+         * A cycle of zero or less beats has no rate and is ignored.
+         */
+        void syncTo(Midi::MidiClock &clock, float beatsPerCycle)
+        {
+            if (beatsPerCycle <= 0.0f)
+            {
+                return;
+            }
+            _clock = &clock;
+            _beatsPerCycle = beatsPerCycle;
+        }
+
+        void unsync()
+        {
+            _clock = nullptr;
+        }
     };
 }
\ No newline at end of file
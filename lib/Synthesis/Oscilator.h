@@ -40,6 +40,7 @@
 
 #pragma once
 #include <cstddef>
+#include <stdint.h>
 #include "SampleBuffer.h"
 #include "WaveForms.h"
 #include <math.h>
@@ -56,8 +57,8 @@ namespace Synthesis
         float _pitchMultiplier;
         float _volume;
         float _morph;
-        WaveForms::WaveForm &_morphWaveForm;
-        WaveForms::WaveForm &_oscilatorWaveForm;
+        WaveForms::WaveForm *_morphWaveForm;
+        WaveForms::WaveForm *_oscilatorWaveForm;
 
     public:
         OscilatorConfig() : _pitch(1.0f),
@@ -65,42 +66,42 @@ namespace Synthesis
                             _pitchMultiplier(1.0f),
                             _volume(0.0),
                             _morph(0),
-                            _morphWaveForm(WaveForms::All::sine()),
-                            _oscilatorWaveForm(WaveForms::All::sawTooth()),
+                            _morphWaveForm(&WaveForms::All<>::sine()),
+                            _oscilatorWaveForm(&WaveForms::All<>::sawTooth())
         {
         }
-        float calculateSamplePitch()
+        float calculateSamplePitch() const
         {
             return ((_pitchMultiplier)*_pitchOctave * _pitch);
         }
         inline void setPitchOctave(uint8_t value) { _pitchOctave = value; }
-        inline uint8_t getPitchOctave() { return _pitchOctave; }
+        inline uint8_t getPitchOctave() const { return _pitchOctave; }
         inline void setPitchMultiplier(float value) { _pitchMultiplier = value; }
-        inline float getPitchMultiplier() { return _pitchMultiplier; }
+        inline float getPitchMultiplier() const { return _pitchMultiplier; }
         inline void setVolume(float value) { _volume = value; }
-        inline float getVolume() { return _volume; }
+        inline float getVolume() const { return _volume; }
         inline void setPitch(float value) { _pitch = value; }
-        inline float getPitch() { return _pitch; }
+        inline float getPitch() const { return _pitch; }
 
         inline void setMorph(float value) { _morph = value; }
-        inline float getMorph() { return _morph; }
-        inline void setMorphWaveForm(WaveForms::WaveForm &value) {_morphWaveForm = value); }
-        inline WaveForms::WaveForm &getMorphWaveForm() { return _morphWaveForm; }
-        inline void setOscilatorWaveForm(WaveForms::WaveForm &value) {_oscilatorWaveForm = value); }
-        inline WaveForms::WaveForm &getOscilatorWaveForm() { return _oscilatorWaveForm; }
+        inline float getMorph() const { return _morph; }
+        inline void setMorphWaveForm(WaveForms::WaveForm &value) { _morphWaveForm = &value; }
+        inline WaveForms::WaveForm &getMorphWaveForm() const { return *_morphWaveForm; }
+        inline void setOscilatorWaveForm(WaveForms::WaveForm &value) { _oscilatorWaveForm = &value; }
+        inline WaveForms::WaveForm &getOscilatorWaveForm() const { return *_oscilatorWaveForm; }
 
-        inline float morphWaveFormAt(size_t offset)
+        inline float morphWaveFormAt(size_t offset) const
         {
             return _morphWaveForm->at(offset);
         }
-        inline float waveFormAt(size_t offset)
+        inline float waveFormAt(size_t offset) const
         {
             return _oscilatorWaveForm->at(offset);
         }
     };
 
     template <size_t BufferLength, uint8_t Voices>
-    class Oscilator : SignalTransformation
+    class Oscilator : public SignalTransformation
     {
     protected:
         uint32_t _samplePos;
@@ -112,30 +113,39 @@ namespace Synthesis
 
     public:
         Oscilator() : _samplePos(0),
+                      _addVal(0),
                       _pan(0),
                       _panEnabled(false),
-                      _config(),
-                      _pitchMod(1)
+                      _pitchMod(1),
+                      _config()
 
         {
         }
 
+        /*
+         * one sample: the phase advances by increment, the morph wave read at the new phase
+         * bends it by up to morph * 64 * 1/48 of a period, the oscillator wave is read there;
+         * the phase is passed in so a voice pool can keep it per voice
+         */
+        static inline float step(uint32_t &samplePos, uint32_t increment, float morph, const OscilatorConfig &config)
+        {
+            samplePos += increment;
+
+            float morphMod = config.morphWaveFormAt((uint32_t)samplePos);
+            morphMod *= ((float)89478480);
+            morphMod *= morph * 64;
+            samplePos += (uint32_t)(int64_t)morphMod;
+
+            return config.waveFormAt(samplePos) * config.getVolume();
+        }
+
         virtual void process(const SampleBuffer &inputSignal, SampleBuffer &outputSignal) override
         {
             for (int i = 0; i < Voices; i++)
             {
                 for (size_t j = 0U; j < BufferLength; j++)
                 {
-                    _samplePos += (uint32_t)(_config.calculateSamplePitch() * (float)_addVal * _pitchMod);
-
-                    float morphMod = _config.morphWaveFormAt((uint32_t)_samplePos);
-                    morphMod *= ((float)89478480);
-                    morphMod *= (_config.getMorph()) * 64;
-                    _samplePos += morphMod;
-
-                    float sig = _config.waveFormAt(_samplePos);
-
-                    sig *= _config.getVolume();
+                    const float sig = step(_samplePos, (uint32_t)(_config.calculateSamplePitch() * (float)_addVal * _pitchMod), _config.getMorph(), _config);
                     outputSignal[j] += sig * (_panEnabled ? _pan : 1.0f);
                 }
             }
@@ -0,0 +1,414 @@
+/**
+ * @file PhaseVocoder.h
+ *
+ * @brief   FFT based pitch shifter and time stretcher
+ *
+ * @see http://blogs.zynaptiq.com/bernsee/pitch-shifting-using-the-ft/
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <math.h>
+#include "SampleBuffer.h"
+#include "SignalTransformation.h"
+#include "Fft.h"
+
+namespace Synthesis
+{
+    /**
+     * Short time Fourier analysis with a Hann window. Every analysis hop the true frequency of
+     * each bin is estimated from its phase advance, bins are moved by the pitch ratio and the
+     * frame is resynthesized with the accumulated phase at the synthesis hop.
+     *
+     * All buffers are sized by MaxFrameLength (a power of two), the frame length and hop can be
+     * changed at runtime within that bound. Latency is frameLength - 1 samples.
+     *
+     * As a SignalTransformation it shifts pitch only. Time stretching changes the output rate,
+     * so it is available through push() / pull() instead; call reset() before switching between the two.
+     */
+    template <size_t BufferLength = 48, size_t MaxFrameLength = 1024>
+    class PhaseVocoder : public SignalTransformation
+    {
+    private:
+        static const size_t MaxBins = MaxFrameLength / 2 + 1;
+        static const size_t OutputLength = MaxFrameLength * 2;
+        static const size_t OutputMask = OutputLength - 1;
+        static const size_t DryMask = MaxFrameLength - 1;
+
+        Fft<MaxFrameLength> _fft;
+        float _window[MaxFrameLength];
+        float _inFifo[MaxFrameLength];
+        float _accum[MaxFrameLength * 2];
+        float _re[MaxFrameLength];
+        float _im[MaxFrameLength];
+        float _lastPhase[MaxBins];
+        float _sumPhase[MaxBins];
+        float _analysisMagnitude[MaxBins];
+        float _analysisBin[MaxBins];
+        float _synthesisMagnitude[MaxBins];
+        float _synthesisBin[MaxBins];
+        uint16_t _peakOf[MaxBins];
+        uint16_t _sourceOf[MaxBins];
+        float _output[OutputLength];
+        float _dry[MaxFrameLength];
+
+        size_t _frameLength;
+        size_t _hop;
+        size_t _synthesisHop;
+        size_t _inCount;
+        size_t _outRead;
+        size_t _outWrite;
+        size_t _dryIndex;
+        float _pitch;
+        float _stretch;
+        float _dryV;
+        float _wetV;
+
+        inline size_t outputAvailable() { return (_outWrite - _outRead) & OutputMask; }
+
+        /*
+         * wrap a phase difference into -PI .. PI
+         */
+        static inline float wrapPhase(float phase)
+        {
+            int32_t turns = (int32_t)(phase / M_PI);
+            turns += (turns >= 0) ? (turns & 1) : -(turns & 1);
+            return phase - M_PI * (float)turns;
+        }
+
+        /*
+         * local maximum of the analysis magnitudes
+         */
+        inline bool isPeak(size_t k, size_t bins) const
+        {
+            const float m = _analysisMagnitude[k];
+            return m > 0.0f && (k == 0 || m >= _analysisMagnitude[k - 1]) && (k + 1 == bins || m > _analysisMagnitude[k + 1]);
+        }
+
+        /*
+         * whole bins a peak moves by, from its true frequency so the moved lobe is centered on the shifted frequency
+         */
+        inline int32_t binShift(size_t peak) const
+        {
+            return (int32_t)floorf(_analysisBin[peak] * (_pitch - 1.0f) + 0.5f);
+        }
+
+        void processFrame(size_t synthesisHop)
+        {
+            const size_t bins = _frameLength / 2 + 1;
+            const float expected = 2.0f * M_PI * (float)_hop / (float)_frameLength;
+            const float binsPerRadian = (float)_frameLength / (2.0f * M_PI * (float)_hop);
+            const float synthesisAdvance = 2.0f * M_PI * (float)synthesisHop / (float)_frameLength;
+            /*
+             * IFFT gain, only half the spectrum is filled, and the Hann^2 overlap sum of 3/8 * frame / hop
+             */
+            const float scale = 2.0f * (float)synthesisHop / (0.375f * (float)_frameLength * (float)_frameLength);
+
+            for (size_t k = 0; k < _frameLength; k++)
+            {
+                _re[k] = _inFifo[k] * _window[k];
+                _im[k] = 0.0f;
+            }
+            _fft.forward(_re, _im);
+
+            /* analysis: magnitude and true frequency (in bins) of every bin */
+            for (size_t k = 0; k < bins; k++)
+            {
+                const float phase = atan2f(_im[k], _re[k]);
+                const float delta = wrapPhase(phase - _lastPhase[k] - (float)k * expected);
+                _lastPhase[k] = phase;
+                _analysisMagnitude[k] = sqrtf(_re[k] * _re[k] + _im[k] * _im[k]);
+                _analysisBin[k] = (float)k + delta * binsPerRadian;
+                _synthesisMagnitude[k] = 0.0f;
+                _synthesisBin[k] = 0.0f;
+            }
+
+            /*
+             * pitch shift: every bin belongs to its nearest spectral peak and moves by that peak's binShift().
+             * Each source bin lands in exactly one target bin and the bins around a peak keep their spacing,
+             * so a partial keeps the shape of its window lobe and its level; bins moved outside the spectrum are dropped
+             */
+            size_t peak = 0;
+            for (size_t k = 0; k < bins; k++)
+            {
+                if (isPeak(k, bins))
+                {
+                    peak = k;
+                }
+                _peakOf[k] = (uint16_t)peak;
+            }
+            peak = bins - 1;
+            for (size_t k = bins; k-- > 0;)
+            {
+                if (isPeak(k, bins))
+                {
+                    peak = k;
+                }
+                if (peak - k < k - _peakOf[k] || !isPeak(_peakOf[k], bins))
+                {
+                    _peakOf[k] = (uint16_t)peak;
+                }
+            }
+            for (size_t k = 0; k < bins; k++)
+            {
+                const int32_t target = (int32_t)k + binShift(_peakOf[k]);
+                if (target < 0 || target >= (int32_t)bins)
+                {
+                    continue;
+                }
+                // where bins meet, the strongest one sets frequency and phase
+                if (_synthesisMagnitude[target] == 0.0f || _analysisMagnitude[k] > _analysisMagnitude[_sourceOf[target]])
+                {
+                    _synthesisBin[target] = _analysisBin[k] * _pitch;
+                    _sourceOf[target] = (uint16_t)k;
+                }
+                _synthesisMagnitude[target] += _analysisMagnitude[k];
+            }
+
+            /* synthesis: accumulate phase at the synthesis hop */
+            for (size_t k = 0; k < bins; k++)
+            {
+                _sumPhase[k] = wrapPhase(_sumPhase[k] + _synthesisBin[k] * synthesisAdvance);
+            }
+            /*
+             * bins around a peak take the peak's synthesis phase plus their analysis phase offset
+             * to it (identity phase locking), negative frequencies stay empty
+             */
+            for (size_t k = 0; k < bins; k++)
+            {
+                float phase = _sumPhase[k];
+                if (_synthesisMagnitude[k] > 0.0f)
+                {
+                    const size_t source = _sourceOf[k];
+                    const size_t peak = _peakOf[source];
+                    const int32_t peakTarget = (int32_t)peak + binShift(peak);
+                    if (source != peak && peakTarget >= 0 && peakTarget < (int32_t)bins)
+                    {
+                        phase = _sumPhase[peakTarget] + _lastPhase[source] - _lastPhase[peak];
+                    }
+                }
+                _re[k] = _synthesisMagnitude[k] * cosf(phase);
+                _im[k] = _synthesisMagnitude[k] * sinf(phase);
+            }
+            for (size_t k = bins; k < _frameLength; k++)
+            {
+                _re[k] = 0.0f;
+                _im[k] = 0.0f;
+            }
+            _fft.inverse(_re, _im);
+
+            for (size_t k = 0; k < _frameLength; k++)
+            {
+                _accum[k] += _window[k] * _re[k] * scale;
+            }
+
+            for (size_t k = 0; k < synthesisHop; k++)
+            {
+                _output[_outWrite] = _accum[k];
+                _outWrite = (_outWrite + 1) & OutputMask;
+            }
+            for (size_t k = 0; k < _frameLength; k++)
+            {
+                _accum[k] = _accum[k + synthesisHop];
+            }
+            for (size_t k = _frameLength; k < _frameLength + synthesisHop; k++)
+            {
+                _accum[k] = 0.0f;
+            }
+
+            for (size_t k = 0; k < _frameLength - _hop; k++)
+            {
+                _inFifo[k] = _inFifo[k + _hop];
+            }
+            _inCount = _frameLength - _hop;
+        }
+
+        void updateSynthesisHop()
+        {
+            _synthesisHop = (size_t)((float)_hop * _stretch + 0.5f);
+            if (_synthesisHop < 1)
+            {
+                _synthesisHop = 1;
+            }
+            if (_synthesisHop > _frameLength / 2)
+            {
+                _synthesisHop = _frameLength / 2;
+            }
+        }
+
+    public:
+        static_assert((MaxFrameLength & (MaxFrameLength - 1)) == 0, "MaxFrameLength must be a power of two");
+
+        /* lowest pitch ratio, about seven octaves down */
+        const float MinimumPitch = 1.0f / 128.0f;
+        const size_t DefaultFrameLength = MaxFrameLength;
+        const size_t DefaultOverlap = 4;
+        const size_t LowLatencyFrameLength = MaxFrameLength / 4;
+
+        PhaseVocoder() : _pitch(1.0f),
+                         _stretch(1.0f),
+                         _dryV(0.0f),
+                         _wetV(1.0f)
+        {
+            configure(DefaultFrameLength, DefaultFrameLength / DefaultOverlap);
+        }
+
+        /**
+         * @param frameLength power of two, at least 4 and at most MaxFrameLength
+         * @param hop analysis hop, frameLength / 4 or smaller gives clean results
+         * @return false and the previous configuration kept when frameLength is not a valid size
+         */
+        bool configure(size_t frameLength, size_t hop)
+        {
+            if (frameLength < 4 || frameLength > MaxFrameLength || (frameLength & (frameLength - 1)) != 0)
+            {
+                return false;
+            }
+            if (hop < 1 || hop > frameLength / 2)
+            {
+                hop = frameLength / DefaultOverlap;
+            }
+            _frameLength = frameLength;
+            _hop = hop;
+            _fft.setLength(_frameLength);
+            for (size_t k = 0; k < _frameLength; k++)
+            {
+                _window[k] = 0.5f - 0.5f * cosf(2.0f * M_PI * (float)k / (float)_frameLength);
+            }
+            updateSynthesisHop();
+            reset();
+            return true;
+        }
+
+        /**
+         * quarter size frames: about a quarter of the latency at the cost of low frequency resolution
+         */
+        void setLowLatency(bool lowLatency)
+        {
+            const size_t frameLength = lowLatency ? LowLatencyFrameLength : DefaultFrameLength;
+            configure(frameLength, frameLength / DefaultOverlap);
+        }
+
+        virtual void reset() override
+        {
+            for (size_t k = 0; k < MaxFrameLength; k++)
+            {
+                _inFifo[k] = 0.0f;
+                _dry[k] = 0.0f;
+                _accum[k] = 0.0f;
+                _accum[k + MaxFrameLength] = 0.0f;
+            }
+            for (size_t k = 0; k < MaxBins; k++)
+            {
+                _lastPhase[k] = 0.0f;
+                _sumPhase[k] = 0.0f;
+            }
+            _inCount = _frameLength - _hop;
+            _outRead = 0;
+            _outWrite = 0;
+            _dryIndex = 0;
+            /* prime the output so a sample can be read for every sample written */
+            for (size_t k = 0; k + 1 < _hop; k++)
+            {
+                _output[_outWrite] = 0.0f;
+                _outWrite = (_outWrite + 1) & OutputMask;
+            }
+        }
+
+        virtual void process(const SampleBuffer &inputSignal, SampleBuffer &outputSignal) override
+        {
+            const size_t latency = _frameLength - 1;
+            for (size_t n = 0; n < BufferLength; n++)
+            {
+                const float in = inputSignal[n];
+                _inFifo[_inCount++] = in;
+                _dry[_dryIndex] = in;
+                const float dry = _dry[(_dryIndex - latency) & DryMask];
+                _dryIndex = (_dryIndex + 1) & DryMask;
+
+                if (_inCount >= _frameLength)
+                {
+                    processFrame(_hop);
+                }
+                float wet = 0.0f;
+                if (outputAvailable() > 0)
+                {
+                    wet = _output[_outRead];
+                    _outRead = (_outRead + 1) & OutputMask;
+                }
+                outputSignal[n] = wet * _wetV + dry * _dryV;
+            }
+        }
+
+        /**
+         * Time stretch input. Returns how many samples were consumed, which is less than
+         * count when pull() has not been called often enough to leave room for the output.
+         */
+        size_t push(const float *input, size_t count)
+        {
+            size_t n = 0;
+            for (; n < count; n++)
+            {
+                if (_inCount + 1 >= _frameLength && outputAvailable() + _synthesisHop >= OutputLength)
+                {
+                    break;
+                }
+                _inFifo[_inCount++] = input[n];
+                if (_inCount >= _frameLength)
+                {
+                    processFrame(_synthesisHop);
+                }
+            }
+            return n;
+        }
+
+        /**
+         * Reads up to count stretched samples, returns how many were available
+         */
+        size_t pull(float *output, size_t count)
+        {
+            size_t n = 0;
+            for (; n < count && outputAvailable() > 0; n++)
+            {
+                output[n] = _output[_outRead];
+                _outRead = (_outRead + 1) & OutputMask;
+            }
+            return n;
+        }
+
+        /**
+         * @param ratio frequency ratio, 2.0 is one octave up, limited to MinimumPitch and above
+         */
+        void setPitch(float ratio)
+        {
+            _pitch = ratio > MinimumPitch ? ratio : MinimumPitch;
+        }
+
+        void setSemitones(float semitones)
+        {
+            setPitch(powf(2.0f, semitones / 12.0f));
+        }
+
+        /**
+         * @param ratio output length / input length, only used by push() / pull()
+         */
+        void setStretch(float ratio)
+        {
+            _stretch = ratio;
+            updateSynthesisHop();
+        }
+
+        /**
+         * Works like a cross fader, same as PitchShifter::setMix.
+         * The dry signal is delayed by the latency so both stay aligned.
+         */
+        void setMix(float mix)
+        {
+            _dryV = (mix >= 0.5f) ? ((1.0f - mix) * 2.0f) : 1.0f;
+            _wetV = (mix >= 0.5f) ? 1.0f : ((mix) * 2.0f);
+        }
+
+        inline size_t latency() { return _frameLength - 1; }
+    };
+}
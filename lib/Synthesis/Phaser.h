@@ -39,62 +39,179 @@
  * @see little demo: https://youtu.be/hqK_U22Jha8
  */
 #pragma once
+#include <stdint.h>
+#include <math.h>
+#include "SampleBuffer.h"
 #include "SignalTransformation.h"
-#include "AllPass.h"
 namespace Synthesis
 {
-    template <size_t BufferLength = 48>
-    class Phaser : public SignalTransformation
+    /**
+     * Cascade of first-order all-pass stages, y = a * x + s, s = x - a * y.
+     * Every stage depends on the one before, so the stages run one after another;
+     * only independent channels (lanes) are processed side by side. State is stored
+     * with the lanes next to each other, which lets the compiler vectorise the lane
+     * loop of StereoPhaser, the mono Phaser is a single lane and runs scalar.
+     */
+    template <size_t Lanes, size_t MaxStages>
+    class AllPassCascade
     {
     private:
-        class PhaserAllPass : public AllPass
+        float _state[MaxStages][Lanes];
+        size_t _stages;
+
+    public:
+        AllPassCascade() : _stages(MaxStages)
+        {
+            reset();
+        }
+        void reset()
+        {
+            for (size_t s = 0; s < MaxStages; s++)
+            {
+                for (size_t l = 0; l < Lanes; l++)
+                {
+                    _state[s][l] = 0.0f;
+                }
+            }
+        }
+        inline void process(float (&x)[Lanes], const float (&a)[Lanes])
         {
-        protected:
-            SampleBuffer &_lfoBuffer;
-            float _phaserMod = 1.0f;
-            virtual void updateWorkingCopy(size_t index, uint32_t &p, float &g, uint32_t &lim) override
+            for (size_t s = 0; s < _stages; s++)
             {
-                uint32_t len = 3 + (1 + _lfoBuffer[index]) * _phaserMod * 48.0f;
-                if (p >= len)
+                for (size_t l = 0; l < Lanes; l++)
                 {
-                    p -= len;
+                    const float y = a[l] * x[l] + _state[s][l];
+                    _state[s][l] = x[l] - a[l] * y;
+                    x[l] = y;
                 }
             }
+        }
+        void setStages(size_t stages)
+        {
+            _stages = stages > MaxStages ? MaxStages : stages;
+        }
+        inline size_t stages() { return _stages; }
+    };
+
+    /**
+     * Phaser with 2 to MaxStages first-order all-pass stages, feedback and a sine LFO sweeping
+     * the break frequency exponentially between the min and max frequency.
+     * The coefficient is computed from the LFO at both ends of a block and interpolated,
+     * so there is no trigonometry and no virtual call inside the sample loop.
+     */
+    template <size_t BufferLength, size_t Lanes, size_t MaxStages>
+    class PhaserCore
+    {
+    public:
+        const size_t DefaultStages = 4;
+        const float DefaultRate = 0.5f;
+        const float DefaultMinFrequency = 200.0f;
+        const float DefaultMaxFrequency = 2000.0f;
+
+    protected:
+        AllPassCascade<Lanes, MaxStages> _cascade;
+        float _sampleRate;
+        float _rate;
+        float _lfoPhase;
+        float _laneOffset[Lanes];
+        float _minFrequency;
+        float _maxFrequency;
+        float _depth;
+        float _feedback;
+        float _inputLevel;
+        float _lastOut[Lanes];
 
-        public:
-            PhaserAllPass(SampleBuffer &lfoBuffer) : _lfoBuffer(lfoBuffer), _phaserMod(1.0) {}
+        inline float coefficientAt(float lfoPhase)
+        {
+            const float lfo = 0.5f + 0.5f * sinf(2.0f * M_PI * lfoPhase);
+            const float frequency = _minFrequency * powf(_maxFrequency / _minFrequency, lfo);
+            const float t = tanf(M_PI * frequency / _sampleRate);
+            return (t - 1.0f) / (t + 1.0f);
+        }
 
-            void reset()
+        void processBlock(float (&signal)[Lanes][BufferLength])
+        {
+            float a[Lanes];
+            float step[Lanes];
+            const float blockPhase = _rate * (float)BufferLength / _sampleRate;
+            for (size_t l = 0; l < Lanes; l++)
+            {
+                a[l] = coefficientAt(_lfoPhase + _laneOffset[l]);
+                step[l] = (coefficientAt(_lfoPhase + _laneOffset[l] + blockPhase) - a[l]) / (float)BufferLength;
+            }
+            _lfoPhase += blockPhase;
+            if (_lfoPhase >= 1.0f)
             {
-                _phaserMod = 1.0;
+                _lfoPhase -= 1.0f;
             }
-        };
 
-        PhaserAllPass _allPass;
-        SampleBuffer &_lfoBuffer;
-        float _inputLevel = 1.0f;
-        float _depth = 1.0f;
+            const float wet = 0.5f * _depth;
+            const float dry = 1.0f - wet;
+            for (size_t n = 0; n < BufferLength; n++)
+            {
+                float x[Lanes];
+                for (size_t l = 0; l < Lanes; l++)
+                {
+                    x[l] = signal[l][n] * _inputLevel + _feedback * _lastOut[l];
+                }
+                _cascade.process(x, a);
+                for (size_t l = 0; l < Lanes; l++)
+                {
+                    _lastOut[l] = x[l];
+                    signal[l][n] = signal[l][n] * dry + x[l] * wet;
+                    a[l] += step[l];
+                }
+            }
+        }
 
     public:
-        Phaser(SampleBuffer &phaserBuffer, SampleBuffer &lfoBuffer) : _lfoBuffer(lfoBuffer),
-                                                                      _allPass(lfoBuffer)
+        PhaserCore(float sampleRate) : _sampleRate(sampleRate),
+                                       _rate(DefaultRate),
+                                       _lfoPhase(0.0f),
+                                       _minFrequency(DefaultMinFrequency),
+                                       _maxFrequency(DefaultMaxFrequency),
+                                       _depth(1.0f),
+                                       _feedback(0.0f),
+                                       _inputLevel(1.0f)
         {
+            for (size_t l = 0; l < Lanes; l++)
+            {
+                _laneOffset[l] = 0.0f;
+                _lastOut[l] = 0.0f;
+            }
+            setStages(DefaultStages);
         }
 
-        virtual void process(const SampleBuffer &inputSignal, SampleBuffer &outputSignal)
+        void reset()
         {
-
-            _allPass.reset();
-            _allPass.process(inputSignal, outputSignal);
-            for (int n = 0; n < BufferLength; n++)
+            _cascade.reset();
+            _lfoPhase = 0.0f;
+            for (size_t l = 0; l < Lanes; l++)
             {
-                outputSignal[n] = inputSignal[n] - outputSignal[n] * _depth;
+                _lastOut[l] = 0.0f;
             }
         }
-        virtual void reset()
+
+        /**
+         * @param stages 4, 6, 8, 12 ... rounded down to an even count, each pair adds one notch
+         */
+        void setStages(size_t stages)
+        {
+            stages &= ~((size_t)1);
+            _cascade.setStages(stages < 2 ? 2 : stages);
+        }
+        inline size_t stages() { return _cascade.stages(); }
+
+        void setRate(float hz)
         {
-            _allPass.reset();
-        };
+            _rate = hz;
+        }
+
+        void setRange(float minFrequency, float maxFrequency)
+        {
+            _minFrequency = minFrequency;
+            _maxFrequency = maxFrequency;
+        }
 
         void setInputLevel(float value)
         {
@@ -106,9 +223,79 @@ namespace Synthesis
             _depth = value;
         }
 
-        void setG(float value)
+        /**
+         * @param value -0.95 .. 0.95, sharpens the notches
+         */
+        void setFeedback(float value)
+        {
+            _feedback = value > 0.95f ? 0.95f : (value < -0.95f ? -0.95f : value);
+        }
+    };
+
+    template <size_t BufferLength = 48, size_t MaxStages = 12>
+    class Phaser : public SignalTransformation, public PhaserCore<BufferLength, 1, MaxStages>
+    {
+    public:
+        Phaser(float sampleRate) : PhaserCore<BufferLength, 1, MaxStages>(sampleRate) {}
+
+        virtual void process(const SampleBuffer &inputSignal, SampleBuffer &outputSignal) override
+        {
+            float signal[1][BufferLength];
+            for (size_t n = 0; n < BufferLength; n++)
+            {
+                signal[0][n] = inputSignal[n];
+            }
+            this->processBlock(signal);
+            for (size_t n = 0; n < BufferLength; n++)
+            {
+                outputSignal[n] = signal[0][n];
+            }
+        }
+        virtual void reset() override
+        {
+            PhaserCore<BufferLength, 1, MaxStages>::reset();
+        }
+    };
+
+    /**
+     * Both channels run through the same cascade code as two lanes,
+     * the right channel LFO is offset by the stereo phase.
+     */
+    template <size_t BufferLength = 48, size_t MaxStages = 12>
+    class StereoPhaser : public PhaserCore<BufferLength, 2, MaxStages>
+    {
+    public:
+        StereoPhaser(float sampleRate) : PhaserCore<BufferLength, 2, MaxStages>(sampleRate)
+        {
+            setStereoPhase(0.25f);
+        }
+
+        void processInplace(StereoSampleBuffer &signal)
+        {
+            process(signal, signal);
+        }
+        void process(StereoSampleBuffer &inputSignal, StereoSampleBuffer &outputSignal)
+        {
+            float signal[2][BufferLength];
+            for (size_t n = 0; n < BufferLength; n++)
+            {
+                signal[0][n] = inputSignal.left()[n];
+                signal[1][n] = inputSignal.right()[n];
+            }
+            this->processBlock(signal);
+            for (size_t n = 0; n < BufferLength; n++)
+            {
+                outputSignal.left()[n] = signal[0][n];
+                outputSignal.right()[n] = signal[1][n];
+            }
+        }
+
+        /**
+         * @param offset right channel LFO offset in cycles, 0.25 is 90 degrees
+         */
+        void setStereoPhase(float offset)
         {
-            _allPass.setG(value);
+            this->_laneOffset[1] = offset;
         }
     };
-}
\ No newline at end of file
+}
@@ -47,18 +47,15 @@
 namespace Synthesis
 {
 
-    template <size_t BufferLength = 48>
-    class ReverbAllPass : public AllPass<BufferLength>
-    {
-    protected:
-        virtual void updateWorkingCopy(size_t index, uint32_t &p, float &g, uint32_t &lim) override
-        {
-            if (p >= lim)
-            {
-                p = 0;
-            }
-        }
-    };
+    /*
+     * fixed loop length, restarts at the beginning of the delay line
+     */
+    template <size_t DelayLength, size_t BufferLength = 48>
+    using ReverbAllPass = AllPass<DelayLength, DelayLinePolicies::WrapToStart, BufferLength>;
+
+    template <size_t DelayLength, size_t BufferLength = 48>
+    using ReverbComb = Comb<DelayLength, DelayLinePolicies::WrapToStart, BufferLength>;
+
     template <size_t SampleBufferLength = 96,
               size_t CombBufferLength_0 = 3460,
               size_t CombBufferLength_1 = 2988,
@@ -71,66 +68,66 @@ namespace Synthesis
     {
     private:
         float _rev_level;
-        Comb<CombBufferLength_0 * CombBufferLength_0> _comb0;
-        Comb<CombBufferLength_1 * CombBufferLength_1> _comb1;
-        Comb<CombBufferLength_2 * CombBufferLength_2> _comb2;
-        Comb<CombBufferLength_3 * CombBufferLength_3> _comb3;
-        ReverbAllPass<AllPassBufferLength_0 * AllPassBufferLength_0> _allPass0;
-        ReverbAllPass<AllPassBufferLength_1 * AllPassBufferLength_1> _allPass1;
-        ReverbAllPass<AllPassBufferLength_2 * AllPassBufferLength_2> _allPass2;
+        ReverbComb<CombBufferLength_0, SampleBufferLength> _comb0;
+        ReverbComb<CombBufferLength_1, SampleBufferLength> _comb1;
+        ReverbComb<CombBufferLength_2, SampleBufferLength> _comb2;
+        ReverbComb<CombBufferLength_3, SampleBufferLength> _comb3;
+        ReverbAllPass<AllPassBufferLength_0, SampleBufferLength> _allPass0;
+        ReverbAllPass<AllPassBufferLength_1, SampleBufferLength> _allPass1;
+        ReverbAllPass<AllPassBufferLength_2, SampleBufferLength> _allPass2;
+        StaticSampleBuffer<SampleBufferLength> _newsample;
 
     public:
-        Reverb() : _comb1(0, 0.827f, (int)(1.0f * CombBufferLength_1 * CombBufferLength_1)),
-                   _comb2(0, 0.783f, (int)(1.0f * CombBufferLength_2 * CombBufferLength_2)),
-                   _comb3(0, 0.764f, (int)(1.0f * CombBufferLength_3 * CombBufferLength_3)),
-                   _allPass0(0, 0.7f, (int)(1.0f * AllPassBufferLength_0 * AllPassBufferLength_0)),
-                   _allPass1(0, 0.7f, (int)(1.0f * AllPassBufferLength_1 * AllPassBufferLength_1)),
-                   _allPass2(0, 0.7f, (int)(1.0f * AllPassBufferLength_2 * AllPassBufferLength_2)),
-                   _rev_time(1.0f),
-                   _rev_level(0)
+        Reverb() : Reverb(1.0f, 0.0f)
         {
         }
 
-        Reverb(float rev_time, float rev_level) : _comb0(0, 0.805f, (int)(rev_time * CombBufferLength_0 * CombBufferLength_0)),
-                                                  _comb1(0, 0.827f, (int)(rev_time * CombBufferLength_1 * CombBufferLength_1)),
-                                                  _comb2(0, 0.783f, (int)(rev_time * CombBufferLength_2 * CombBufferLength_2)),
-                                                  _comb3(0, 0.764f, (int)(rev_time * CombBufferLength_3 * CombBufferLength_3)),
-                                                  _allPass0(0, 0.7f, (int)(rev_time * AllPassBufferLength_0 * AllPassBufferLength_0)),
-                                                  _allPass1(0, 0.7f, (int)(rev_time * AllPassBufferLength_1 * AllPassBufferLength_1)),
-                                                  _allPass2(0, 0.7f, (int)(rev_time * AllPassBufferLength_2 * AllPassBufferLength_2)),
-                                                  _rev_level(rev_level)
+        Reverb(float rev_time, float rev_level) : _rev_level(rev_level),
+                                                  _comb0(0, 0.805f, (uint32_t)(rev_time * CombBufferLength_0)),
+                                                  _comb1(0, 0.827f, (uint32_t)(rev_time * CombBufferLength_1)),
+                                                  _comb2(0, 0.783f, (uint32_t)(rev_time * CombBufferLength_2)),
+                                                  _comb3(0, 0.764f, (uint32_t)(rev_time * CombBufferLength_3)),
+                                                  _allPass0(0, 0.7f, (uint32_t)(rev_time * AllPassBufferLength_0)),
+                                                  _allPass1(0, 0.7f, (uint32_t)(rev_time * AllPassBufferLength_1)),
+                                                  _allPass2(0, 0.7f, (uint32_t)(rev_time * AllPassBufferLength_2))
         {
         }
         virtual void process(const SampleBuffer &inputSample, SampleBuffer &outputSample) override
         {
+            _newsample.clear();
+            _comb0.process(inputSample, _newsample);
+            _comb1.process(inputSample, _newsample);
+            _comb2.process(inputSample, _newsample);
+            _comb3.process(inputSample, _newsample);
 
-            StaticSampleBuffer<SampleBufferLength> newsample();
-
-            newsample.clear();
-            _comb0.process(inputCopy, newsample);
-            _comb1.process(inputCopy, newsample);
-            _comb2.process(inputCopy, newsample);
-            _comb3.process(inputCopy, newsample);
-
-            for (int n = 0; n < SampleBufferLength; n++)
+            for (size_t n = 0; n < SampleBufferLength; n++)
             {
-                newsample[n] *= 0.25f;
+                _newsample[n] *= 0.25f;
             }
-            _allPass0.processInplace(newsample);
-            _allPass1.processInplace(newsample);
-            _allPass2.processInplace(newsample);
+            _allPass0.processInplace(_newsample);
+            _allPass1.processInplace(_newsample);
+            _allPass2.processInplace(_newsample);
 
             /* apply reverb level */
 
-            for (int n = 0; n < SampleBufferLength; n++)
+            for (size_t n = 0; n < SampleBufferLength; n++)
             {
-                newsample[n] *= _rev_level;
-                out[n] = signal_l[n] + newsample[n];
+                outputSample[n] = inputSample[n] + _newsample[n] * _rev_level;
             }
         }
+        virtual void reset() override
+        {
+            _comb0.reset();
+            _comb1.reset();
+            _comb2.reset();
+            _comb3.reset();
+            _allPass0.reset();
+            _allPass1.reset();
+            _allPass2.reset();
+        }
         void setLevel(float level)
         {
-            _rev_level = leve;
+            _rev_level = level;
         }
     };
 }
\ No newline at end of file
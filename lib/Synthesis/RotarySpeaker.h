@@ -0,0 +1,288 @@
+/**
+ * @file RotarySpeaker.h
+ *
+ * @brief   Leslie style rotary speaker
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <math.h>
+#include "SampleBuffer.h"
+#include "SignalTransformation.h"
+
+namespace Synthesis
+{
+    enum class RotarySpeed
+    {
+        brake,
+        chorale,
+        tremolo
+    };
+
+    /**
+     * The input is split by a one-pole crossover into a drum (low) and a horn (high) rotor.
+     * Each rotor is a Vibrato style modulated fractional delay (Doppler) followed by a Tremolo
+     * style gain (AM), both driven by one quadrature oscillator. The oscillator's sin/cos pair
+     * feeds the two virtual microphones, so the rotation is computed once per rotor and shared
+     * by the AM, the Doppler and both output channels.
+     *
+     * Rotor speeds approach their target with separate spin up and slow down times,
+     * switched with setSpeed() or from MIDI with controlChange().
+     */
+    template <size_t BufferLength = 48, size_t DopplerLength = 256>
+    class RotarySpeaker : public SignalTransformation
+    {
+    public:
+        const float DefaultCrossoverFrequency = 800.0f;
+        const uint8_t DefaultSpeedControl = 1;  /* modulation wheel */
+        const uint8_t DefaultBrakeControl = 66; /* sostenuto pedal */
+
+    private:
+        static const size_t DopplerMask = DopplerLength - 1;
+
+        class Rotor
+        {
+        private:
+            float _delay[DopplerLength];
+            uint32_t _write;
+            float _phase;
+            float _speed;
+            float _target;
+            float _choraleSpeed;
+            float _tremoloSpeed;
+            float _spinUp;
+            float _slowDown;
+            float _direction;
+            float _dopplerCenter;
+            float _dopplerDepth;
+            float _amDepth;
+
+            inline float read(float delay)
+            {
+                const float position = (float)_write - delay;
+                const int32_t index = (int32_t)floorf(position);
+                const float fraction = position - (float)index;
+                const float a = _delay[(uint32_t)index & DopplerMask];
+                const float b = _delay[(uint32_t)(index + 1) & DopplerMask];
+                return a + (b - a) * fraction;
+            }
+
+        public:
+            Rotor(float choraleSpeed, float tremoloSpeed, float spinUp, float slowDown, float direction,
+                  float dopplerDepth, float amDepth) : _choraleSpeed(choraleSpeed),
+                                                       _tremoloSpeed(tremoloSpeed),
+                                                       _spinUp(spinUp),
+                                                       _slowDown(slowDown),
+                                                       _direction(direction),
+                                                       _dopplerDepth(dopplerDepth),
+                                                       _amDepth(amDepth)
+            {
+                _dopplerCenter = _dopplerDepth + 2.0f;
+                _speed = _choraleSpeed;
+                _target = _choraleSpeed;
+                reset();
+            }
+
+            void reset()
+            {
+                for (size_t n = 0; n < DopplerLength; n++)
+                {
+                    _delay[n] = 0.0f;
+                }
+                _write = 0;
+                _phase = 0.0f;
+            }
+
+            void setSpeed(RotarySpeed speed)
+            {
+                _target = speed == RotarySpeed::tremolo ? _tremoloSpeed : (speed == RotarySpeed::chorale ? _choraleSpeed : 0.0f);
+            }
+
+            /**
+             * @param spinUp, slowDown one-pole coefficients per block
+             */
+            void setInertia(float spinUp, float slowDown)
+            {
+                _spinUp = spinUp;
+                _slowDown = slowDown;
+            }
+
+            inline float speed() { return _speed; }
+
+            void process(const float *input, float *left, float *right, float sampleRate)
+            {
+                _speed += (_target - _speed) * (_target > _speed ? _spinUp : _slowDown);
+
+                /* the only trigonometry per block: start point and per sample rotation */
+                const float omega = _direction * 2.0f * M_PI * _speed / sampleRate;
+                float c = cosf(_phase);
+                float s = sinf(_phase);
+                const float rc = cosf(omega);
+                const float rs = sinf(omega);
+                _phase += omega * (float)BufferLength;
+                _phase = fmodf(_phase, 2.0f * M_PI);
+
+                const float amHalf = 0.5f * _amDepth;
+                for (size_t n = 0; n < BufferLength; n++)
+                {
+                    _delay[_write & DopplerMask] = input[n];
+
+                    /* microphones 90 degrees apart, left hears sin, right hears cos */
+                    const float outL = read(_dopplerCenter + _dopplerDepth * s);
+                    const float outR = read(_dopplerCenter + _dopplerDepth * c);
+                    left[n] += outL * (1.0f - amHalf + amHalf * s);
+                    right[n] += outR * (1.0f - amHalf + amHalf * c);
+
+                    _write++;
+                    const float nc = c * rc - s * rs;
+                    s = s * rc + c * rs;
+                    c = nc;
+                }
+            }
+        };
+
+        float _sampleRate;
+        float _crossoverCoefficient;
+        float _crossoverState;
+        float _hornLevel;
+        float _drumLevel;
+        Rotor _horn;
+        Rotor _drum;
+        RotarySpeed _speed;
+        bool _brake;
+        uint8_t _speedControl;
+        uint8_t _brakeControl;
+        float _low[BufferLength];
+        float _high[BufferLength];
+        float _left[BufferLength];
+        float _right[BufferLength];
+
+        /*
+         * one-pole coefficient for reaching ~63% of a speed change in the given time
+         */
+        inline float inertia(float seconds)
+        {
+            return 1.0f - expf(-(float)BufferLength / (seconds * _sampleRate));
+        }
+
+        void render(const SampleBuffer &inputSignal)
+        {
+            for (size_t n = 0; n < BufferLength; n++)
+            {
+                const float in = inputSignal[n];
+                _crossoverState += (in - _crossoverState) * _crossoverCoefficient;
+                _low[n] = _crossoverState * _drumLevel;
+                _high[n] = (in - _crossoverState) * _hornLevel;
+                _left[n] = 0.0f;
+                _right[n] = 0.0f;
+            }
+            _drum.process(_low, _left, _right, _sampleRate);
+            _horn.process(_high, _left, _right, _sampleRate);
+        }
+
+        void applySpeed()
+        {
+            const RotarySpeed speed = _brake ? RotarySpeed::brake : _speed;
+            _horn.setSpeed(speed);
+            _drum.setSpeed(speed);
+        }
+
+    public:
+        /*
+         * horn spins up fast, the heavy drum takes seconds, they rotate in opposite directions
+         */
+        RotarySpeaker(float sampleRate) : _sampleRate(sampleRate),
+                                          _crossoverState(0.0f),
+                                          _hornLevel(1.0f),
+                                          _drumLevel(1.0f),
+                                          _horn(0.83f, 6.75f, 0.0f, 0.0f, 1.0f, 24.0f, 0.35f),
+                                          _drum(0.70f, 5.90f, 0.0f, 0.0f, -1.0f, 4.0f, 0.6f),
+                                          _speed(RotarySpeed::chorale),
+                                          _brake(false),
+                                          _speedControl(DefaultSpeedControl),
+                                          _brakeControl(DefaultBrakeControl)
+        {
+            _horn.setInertia(inertia(0.7f), inertia(1.6f));
+            _drum.setInertia(inertia(4.5f), inertia(5.5f));
+            setCrossoverFrequency(DefaultCrossoverFrequency);
+        }
+
+        virtual void reset() override
+        {
+            _crossoverState = 0.0f;
+            _horn.reset();
+            _drum.reset();
+        }
+
+        /**
+         * mono output, sum of both microphones
+         */
+        virtual void process(const SampleBuffer &inputSignal, SampleBuffer &outputSignal) override
+        {
+            render(inputSignal);
+            for (size_t n = 0; n < BufferLength; n++)
+            {
+                outputSignal[n] = 0.5f * (_left[n] + _right[n]);
+            }
+        }
+
+        void processStereo(const SampleBuffer &inputSignal, StereoSampleBuffer &outputSignal)
+        {
+            render(inputSignal);
+            for (size_t n = 0; n < BufferLength; n++)
+            {
+                outputSignal.left()[n] = _left[n];
+                outputSignal.right()[n] = _right[n];
+            }
+        }
+
+        void setSpeed(RotarySpeed speed)
+        {
+            _speed = speed;
+            applySpeed();
+        }
+
+        void setBrake(bool brake)
+        {
+            _brake = brake;
+            applySpeed();
+        }
+
+        /**
+         * speed control: below 64 chorale, 64 and above tremolo
+         * brake control: 64 and above stops both rotors
+         */
+        void controlChange(uint8_t control, uint8_t value)
+        {
+            if (control == _speedControl)
+            {
+                setSpeed(value >= 64 ? RotarySpeed::tremolo : RotarySpeed::chorale);
+            }
+            else if (control == _brakeControl)
+            {
+                setBrake(value >= 64);
+            }
+        }
+
+        void setControls(uint8_t speedControl, uint8_t brakeControl)
+        {
+            _speedControl = speedControl;
+            _brakeControl = brakeControl;
+        }
+
+        void setCrossoverFrequency(float frequency)
+        {
+            _crossoverCoefficient = 1.0f - expf(-2.0f * M_PI * frequency / _sampleRate);
+        }
+
+        void setLevels(float horn, float drum)
+        {
+            _hornLevel = horn;
+            _drumLevel = drum;
+        }
+
+        inline float hornSpeed() { return _horn.speed(); }
+        inline float drumSpeed() { return _drum.speed(); }
+    };
+}
@@ -3,29 +3,32 @@
 namespace Synthesis
 {
 
-    template <size_t BufferLength = 48>
     class SampleBuffer
     {
 
     public:
-        virtual size_t length() { return BufferLength; }
-        virtual float &operator[](size_t index);
+        virtual ~SampleBuffer() {}
+        virtual size_t length() const = 0;
+        virtual float &operator[](size_t index) = 0;
+        virtual float operator[](size_t index) const = 0;
         virtual void clear()
         {
-            for (size_t i = 0; i < BufferLength; i++)
+            const size_t bufferLength = length();
+            for (size_t i = 0; i < bufferLength; i++)
             {
                 (this->operator[](i)) = 0.0f;
             }
         }
-        virtual void copyTo(SampleBuffer &that)
+        virtual void copyTo(SampleBuffer &that) const
         {
-            for (size_t i = 0; i < BufferLength; i++)
+            const size_t bufferLength = length();
+            for (size_t i = 0; i < bufferLength; i++)
             {
                 that[i] = (this->operator[])(i);
             }
         }
     };
-    template <size_t BufferLength = 48>
+
     class StereoSampleBuffer
     {
     protected:
@@ -36,48 +39,59 @@ namespace Synthesis
         StereoSampleBuffer(SampleBuffer &l, SampleBuffer &r) : _left(l), _right(r)
         {
         }
-        size_t length() { return BufferLength; }
+        size_t length() const { return _left.length(); }
         void clear()
         {
             _left.clear();
             _right.clear();
         }
-        void copyTo(StereoSampleBuffer &that)
+        void copyTo(StereoSampleBuffer &that) const
         {
-            _left.copyTo(that.left);
-            _right.copyTo(that.right);
+            _left.copyTo(that.left());
+            _right.copyTo(that.right());
         }
         SampleBuffer &left() { return _left; }
         SampleBuffer &right() { return _right; }
+        const SampleBuffer &left() const { return _left; }
+        const SampleBuffer &right() const { return _right; }
     };
 
     template <size_t BufferLength = 48>
-    class StaticSampleBuffer : public SampleBuffer<BufferLength>
+    class StaticSampleBuffer : public SampleBuffer
     {
     protected:
-        float[BufferLength] _samples;
+        float _samples[BufferLength];
 
     public:
         StaticSampleBuffer() {}
 
+        virtual size_t length() const override { return BufferLength; }
         virtual float &operator[](size_t index) override
         {
             return _samples[index];
         }
+        virtual float operator[](size_t index) const override
+        {
+            return _samples[index];
+        }
+        inline float *data() { return _samples; }
+        inline const float *data() const { return _samples; }
     };
+
     template <size_t BufferLength = 48>
     class StaticStereoSampleBuffer : public StereoSampleBuffer
     {
     private:
-        StaticSampleBuffer staticLeft;
-        StaticSampleBuffer staticRight;
+        StaticSampleBuffer<BufferLength> staticLeft;
+        StaticSampleBuffer<BufferLength> staticRight;
 
     public:
-        StaticStereoSampleBuffer() : _left(staticLeft), _right(staticRight) {}
+        // the base only stores the references, the buffers are constructed right after it
+        StaticStereoSampleBuffer() : StereoSampleBuffer(staticLeft, staticRight) {}
     };
 
     template <size_t BufferLength = 48>
-    class ReadOnlySampleBuffer : public SampleBuffer<BufferLength>
+    class ReadOnlySampleBuffer : public SampleBuffer
     {
     private:
         float (&_samples)[BufferLength];
@@ -87,11 +101,16 @@ namespace Synthesis
         ReadOnlySampleBuffer(float (&samples)[BufferLength]) : _samples(samples) {}
         ReadOnlySampleBuffer(const ReadOnlySampleBuffer &that) : _samples(that._samples) {}
 
+        virtual size_t length() const override { return BufferLength; }
         virtual float &operator[](size_t index) override
         {
             _bogusSampleForReturnFromOperator = _samples[index];
             return _bogusSampleForReturnFromOperator;
         }
+        virtual float operator[](size_t index) const override
+        {
+            return _samples[index];
+        }
         virtual void clear() override
         {
             // this method intentionally left blank;
@@ -99,7 +118,7 @@ namespace Synthesis
     };
 
     template <size_t BufferLength = 48>
-    class FixedValueSampleBuffer : public SampleBuffer<BufferLength>
+    class FixedValueSampleBuffer : public SampleBuffer
     {
     private:
         float _value;
@@ -109,11 +128,16 @@ namespace Synthesis
         FixedValueSampleBuffer(float value) : _value(value) {}
         FixedValueSampleBuffer(const FixedValueSampleBuffer &that) : _value(that._value) {}
 
+        virtual size_t length() const override { return BufferLength; }
         virtual float &operator[](size_t index) override
         {
             _bogusSampleForReturnFromOperator = _value;
             return _bogusSampleForReturnFromOperator;
         }
+        virtual float operator[](size_t index) const override
+        {
+            return _value;
+        }
         virtual void clear() override
         {
             // this method intentionally left blank;
@@ -46,10 +46,10 @@
 
 namespace Synthesis
 {
-    template <size_t BufferLength = 48>
     class SignalTransformation
     {
     public:
+        virtual ~SignalTransformation() {}
         virtual void processInplace(SampleBuffer &signal)
         {
             process(signal, signal);
@@ -58,7 +58,6 @@ namespace Synthesis
         virtual void reset() = 0;
     };
 
-    template <size_t BufferLength = 48>
     class StereoSignalTransformation
     {
     protected:
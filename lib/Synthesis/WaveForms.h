@@ -51,17 +51,18 @@ namespace Synthesis
         class WaveForm
         {
         public:
+            virtual ~WaveForm() {}
+            /* offset is a 32 bit phase, one period from 0 to 2^32 */
             virtual float at(size_t offset) = 0;
         };
 
         template <size_t BitLength = 10>
         class DynamicWaveForm : public WaveForm
         {
-        protected:
-            const size_t BufferLength = (1 << BitLength);
-
         public:
-            virtual float generateValue(size_t index) = 0;
+            static const size_t BufferLength = (1 << BitLength);
+
+            virtual float generateValue(size_t index) const = 0;
             virtual float at(size_t offset) override
             {
                 return generateValue(((offset) >> (32 - BitLength)) & (BufferLength - 1));
@@ -69,66 +70,70 @@ namespace Synthesis
         };
 
         template <size_t BitLength = 10>
-        class StaticWaveForm : public StaticSampleBuffer<(1 << BitLength)>, WaveForm
+        class StaticWaveForm : public StaticSampleBuffer<(1 << BitLength)>, public WaveForm
         {
         protected:
-            const size_t Mask = ((1 << BitLength) - 1);
-            const size_t BufferLength = (1 << BitLength);
+            static const size_t Mask = ((1 << BitLength) - 1);
+            static const size_t BufferLength = (1 << BitLength);
 
         public:
-            StaticWaveForm(DynamicWaveForm<BitLength> dynamicForm)
+            StaticWaveForm(const DynamicWaveForm<BitLength> &dynamicForm)
             {
                 for (size_t i = 0; i < BufferLength; i++)
                 {
-                    (this->operator[])(i) = dynamicForm.generateValue(i);
+                    this->_samples[i] = dynamicForm.generateValue(i);
                 }
             }
             virtual float at(size_t offset) override
             {
-                return _samples[(((offset) >> (32 - BitLength)) & Mask)];
+                return this->_samples[(((offset) >> (32 - BitLength)) & Mask)];
             }
         };
 
         template <size_t BitLength = 10>
         class SineWaveForm : public DynamicWaveForm<BitLength>
         {
-        protected:
-            virtual float generateValue(size_t index) override { return (float)sin(i * 2.0 * M_PI / BufferLength); }
+        public:
+            virtual float generateValue(size_t index) const override { return (float)sin(index * 2.0 * M_PI / DynamicWaveForm<BitLength>::BufferLength); }
         };
 
         template <size_t BitLength = 10>
         class SawToothWaveForm : public DynamicWaveForm<BitLength>
         {
-        protected:
-            virtual float generateValue(size_t index) override { return (2.0f * ((float)index) / ((float)BufferLength)) - 1.0f; }
+        public:
+            virtual float generateValue(size_t index) const override { return (2.0f * ((float)index) / ((float)DynamicWaveForm<BitLength>::BufferLength)) - 1.0f; }
         };
 
         template <size_t BitLength = 10>
         class SquareWaveForm : public DynamicWaveForm<BitLength>
         {
-        protected:
-            virtual float generateValue(size_t index) override { return (index > (BufferLength / 2)) ? 1 : -1; }
+        public:
+            virtual float generateValue(size_t index) const override { return (index > (DynamicWaveForm<BitLength>::BufferLength / 2)) ? 1 : -1; }
         };
 
         template <size_t BitLength = 10>
         class PulseWaveForm : public DynamicWaveForm<BitLength>
         {
-        protected:
-            virtual float generateValue(size_t index) override { return (index > (BufferLength / 4)) ? 1.0f / 4.0f : -3.0f / 4.0f; }
+        public:
+            virtual float generateValue(size_t index) const override { return (index > (DynamicWaveForm<BitLength>::BufferLength / 4)) ? 1.0f / 4.0f : -3.0f / 4.0f; }
         };
 
         template <size_t BitLength = 10>
         class TriangleWaveForm : public DynamicWaveForm<BitLength>
         {
-        protected:
-            virtual float generateValue(size_t index) override { return ((index > (BufferLength / 2)) ? (((4.0f * (float)index) / ((float)BufferLength)) - 1.0f) : (3.0f - ((4.0f * (float)index) / ((float)BufferLength)))) - 2.0f; }
+        public:
+            virtual float generateValue(size_t index) const override
+            {
+                const float length = (float)DynamicWaveForm<BitLength>::BufferLength;
+                return ((index > (DynamicWaveForm<BitLength>::BufferLength / 2)) ? (((4.0f * (float)index) / length) - 1.0f) : (3.0f - ((4.0f * (float)index) / length))) - 2.0f;
+            }
         };
 
         template <size_t BitLength = 10>
         class NoiseWaveForm : public DynamicWaveForm<BitLength>
         {
-        protected:
-            virtual float generateValue(size_t index) override { return ((rand() % (1024)) / 512.0f) - 1.0f; }
+        public:
+            virtual float generateValue(size_t index) const override { return ((rand() % (1024)) / 512.0f) - 1.0f; }
         };
 
         class SilenceWaveForm : public WaveForm
@@ -137,61 +142,73 @@ namespace Synthesis
             virtual float at(size_t offset) override { return 0; }
         };
 
+        /*
+         * one shared instance per wave form, built on first use;
+         * USE_STATIC_WAVEFORM_* selects a precalculated table instead of calculating every sample
+         */
         template <size_t BitLength = 10>
         class All
         {
-        private:
-            static SilenceWaveForm _silence();
-
+        public:
+            static WaveForm &silence()
+            {
+                static SilenceWaveForm form;
+                return form;
+            }
+            static WaveForm &sine()
+            {
 #if defined(USE_STATIC_WAVEFORM_SINE)
-            static StaticWaveForm<BitLength> _sine(SineWaveForm<BitLength>());
-#endif // defined(USE_STATIC_WAVEFORM_SINE)
-#if !defined(USE_STATIC_WAVEFORM_SINE)
-            static SineWaveForm<BitLength> _sine();
-#endif // !defined(USE_STATIC_WAVEFORM_SINE)
-
+                static StaticWaveForm<BitLength> form((SineWaveForm<BitLength>()));
+#else
+                static SineWaveForm<BitLength> form;
+#endif
+                return form;
+            }
+            static WaveForm &sawTooth()
+            {
 #if defined(USE_STATIC_WAVEFORM_SAW_TOOTH)
-            static StaticWaveForm<BitLength> _sawTooth(SawToothWaveForm<BitLength>());
-#endif // defined(USE_STATIC_WAVEFORM_SAW_TOOTH)
-#if !defined(USE_STATIC_WAVEFORM_SAW_TOOTH)
-            static SawToothWaveForm<BitLength> _sawTooth();
-#endif // !defined(USE_STATIC_WAVEFORM_SAW_TOOTH)
-
+                static StaticWaveForm<BitLength> form((SawToothWaveForm<BitLength>()));
+#else
+                static SawToothWaveForm<BitLength> form;
+#endif
+                return form;
+            }
+            static WaveForm &square()
+            {
 #if defined(USE_STATIC_WAVEFORM_SQUARE)
-            static StaticWaveForm<BitLength> _square(SquareWaveForm<BitLength>());
-#endif // defined(USE_STATIC_WAVEFORM_SQUARE)
-#if !defined(USE_STATIC_WAVEFORM_SQUARE)
-            static SquareWaveForm<BitLength> _square();
-#endif // !defined(USE_STATIC_WAVEFORM_SQUARE)
-
+                static StaticWaveForm<BitLength> form((SquareWaveForm<BitLength>()));
+#else
+                static SquareWaveForm<BitLength> form;
+#endif
+                return form;
+            }
+            static WaveForm &pulse()
+            {
 #if defined(USE_STATIC_WAVEFORM_PULSE)
-            static StaticWaveForm<BitLength> _pulse(PulseWaveForm<BitLength>());
-#endif // defined(USE_STATIC_WAVEFORM_PULSE)
-#if !defined(USE_STATIC_WAVEFORM_PULSE)
-            static PulseWaveForm<BitLength> _pulse();
-#endif // !defined(USE_STATIC_WAVEFORM_PULSE)
-
+                static StaticWaveForm<BitLength> form((PulseWaveForm<BitLength>()));
+#else
+                static PulseWaveForm<BitLength> form;
+#endif
+                return form;
+            }
+            static WaveForm &triangle()
+            {
 #if defined(USE_STATIC_WAVEFORM_TRIANGLE)
-            static StaticWaveForm<BitLength> _triangle(TriangleWaveForm<BitLength>());
-#endif // defined(USE_STATIC_WAVEFORM_TRIANGLE)
-#if !defined(USE_STATIC_WAVEFORM_TRIANGLE)
-            static TriangleWaveForm<BitLength> _triangle();
-#endif // !defined(USE_STATIC_WAVEFORM_TRIANGLE)
-
+                static StaticWaveForm<BitLength> form((TriangleWaveForm<BitLength>()));
+#else
+                static TriangleWaveForm<BitLength> form;
+#endif
+                return form;
+            }
+            static WaveForm &noise()
+            {
 #if defined(USE_STATIC_WAVEFORM_NOISE)
-            static StaticWaveForm<BitLength> _noise(NoiseWaveForm<BitLength>());
-#endif // defined(USE_STATIC_WAVEFORM_NOISE)
-#if !defined(USE_STATIC_WAVEFORM_NOISE)
-            static NoiseWaveForm<BitLength> _noise();
-#endif // !defined(USE_STATIC_WAVEFORM_NOISE)
-        public:
-            static WaveForm &silence() { return _silence; }
-            static WaveForm &sine() { return _sine; }
-            static WaveForm &sawTooth() { return _sawTooth; }
-            static WaveForm &square() { return _square; }
-            static WaveForm &pulse() { return _pulse; }
-            static WaveForm &triangle() { return _triangle; }
-            static WaveForm &noise() { return _noise; }
+                static StaticWaveForm<BitLength> form((NoiseWaveForm<BitLength>()));
+#else
+                static NoiseWaveForm<BitLength> form;
+#endif
+                return form;
+            }
         };
 
     }
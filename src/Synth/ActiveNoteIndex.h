@@ -0,0 +1,169 @@
+/**
+ * @file ActiveNoteIndex.h
+ *
+ * @brief   Constant time lookup of the voice playing a note on a channel
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <cstddef>
+#include "../../lib/Midi/MidiEvent.h"
+
+/*
+ * One bit per (channel, note) that is sounding plus the voice it is sounding on.
+ * NoteOff, PolyphonicKeyPressure and retriggering a held note look the voice up
+ * directly instead of scanning all voices; the bitsets answer "which notes are held"
+ * on a channel with a handful of word operations (All Notes Off, mono note priority).
+ *
+ * A note maps to the voice that started it last. The mapping outlives the NoteOff:
+ * a releasing voice stays mapped until remove(), so a repeated note can take it back
+ * (StealPolicy::sameNote). When an older voice of the same note ends later, remove()
+ * leaves the newer mapping alone.
+ */
+template <size_t MaxVoices = 64>
+class ActiveNoteIndex
+{
+    static_assert(MaxVoices < 255, "voice numbers are stored as bytes");
+
+public:
+    static const uint8_t NoVoice = 0xFF;
+
+private:
+    static const size_t Notes = 128;
+    static const size_t Words = Notes / 32;
+
+    uint32_t _held[Midi::Constants::MaxChannels][Words];
+    uint8_t _voice[Midi::Constants::MaxChannels][Notes];
+    uint8_t _count[Midi::Constants::MaxChannels];
+
+    inline void set(uint8_t channel, uint8_t note)
+    {
+        _held[channel][note >> 5] |= 1u << (note & 31);
+    }
+
+    inline void unset(uint8_t channel, uint8_t note)
+    {
+        _held[channel][note >> 5] &= ~(1u << (note & 31));
+    }
+
+public:
+    ActiveNoteIndex()
+    {
+        clear();
+    }
+
+    void clear()
+    {
+        for (size_t c = 0; c < Midi::Constants::MaxChannels; c++)
+        {
+            clearChannel(c);
+        }
+    }
+
+    void clearChannel(uint8_t channel)
+    {
+        for (size_t w = 0; w < Words; w++)
+        {
+            _held[channel][w] = 0;
+        }
+        for (size_t n = 0; n < Notes; n++)
+        {
+            _voice[channel][n] = NoVoice;
+        }
+        _count[channel] = 0;
+    }
+
+    /*
+     * records that voice now plays the note,
+     * returns the voice that was already mapped to it, held or releasing, or NoVoice
+     */
+    inline uint8_t noteOn(uint8_t channel, uint8_t note, uint8_t voice)
+    {
+        const uint8_t previous = _voice[channel][note];
+        if (!isHeld(channel, note))
+        {
+            set(channel, note);
+            _count[channel]++;
+        }
+        _voice[channel][note] = voice;
+        return previous;
+    }
+
+    /*
+     * the note is no longer held, returns the voice that should be released or NoVoice;
+     * the voice stays mapped while it releases
+     */
+    inline uint8_t noteOff(uint8_t channel, uint8_t note)
+    {
+        if (!isHeld(channel, note))
+        {
+            return NoVoice;
+        }
+        unset(channel, note);
+        _count[channel]--;
+        return _voice[channel][note];
+    }
+
+    /*
+     * a voice ended or was stolen, only drops the mapping if it still points at that voice
+     */
+    inline void remove(uint8_t channel, uint8_t note, uint8_t voice)
+    {
+        if (_voice[channel][note] == voice)
+        {
+            noteOff(channel, note);
+            _voice[channel][note] = NoVoice;
+        }
+    }
+
+    /* voice mapped to the note, held or releasing */
+    inline uint8_t voiceOf(uint8_t channel, uint8_t note) const { return _voice[channel][note]; }
+    inline bool isHeld(uint8_t channel, uint8_t note) const { return (_held[channel][note >> 5] >> (note & 31)) & 1; }
+    inline uint8_t heldCount(uint8_t channel) const { return _count[channel]; }
+
+    /*
+     * lowest / highest held note of a channel, -1 when none is held
+     */
+    int lowestNote(uint8_t channel) const
+    {
+        for (size_t w = 0; w < Words; w++)
+        {
+            if (_held[channel][w] != 0)
+            {
+                return (int)(w * 32 + __builtin_ctz(_held[channel][w]));
+            }
+        }
+        return -1;
+    }
+
+    int highestNote(uint8_t channel) const
+    {
+        for (size_t w = Words; w-- > 0;)
+        {
+            if (_held[channel][w] != 0)
+            {
+                return (int)(w * 32 + 31 - __builtin_clz(_held[channel][w]));
+            }
+        }
+        return -1;
+    }
+
+    /*
+     * calls f(note, voice) for every held note of a channel, lowest first
+     */
+    template <class F>
+    void forEachHeld(uint8_t channel, F f) const
+    {
+        for (size_t w = 0; w < Words; w++)
+        {
+            uint32_t bits = _held[channel][w];
+            while (bits != 0)
+            {
+                const uint8_t note = (uint8_t)(w * 32 + __builtin_ctz(bits));
+                bits &= bits - 1;
+                f(note, _voice[channel][note]);
+            }
+        }
+    }
+};
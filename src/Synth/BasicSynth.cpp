@@ -1,7 +1,9 @@
 #include "config.h"
 #include "../lib/Synthesis.h"
 #include "../lib/Midi.h"
+#include "Synth.h"
 
 Synthesis::StaticStereoSampleBuffer<SAMPLE_BUFFER_SIZE> buffer;
 
-static std::array<ChannelSettings, Midi::Constants::MaxChannels> channelConfigs;
\ No newline at end of file
+/* one part per MIDI channel, see Synth::patch() */
+static Synth<> synth;
\ No newline at end of file
@@ -36,14 +36,37 @@
  * @brief   This file contains a simple implementation for a polyphonic synthesizer
  */
 
+#pragma once
+
 #include <stdint.h>
-#include "../lib/Synthesis.h"
-#include "../lib/Midi.h"
-#define NOTE_STACK_MAX 8
+#include <cstddef>
+#include "config.h"
+#include "../../lib/Synthesis/Envelope.h"
+#include "../../lib/Synthesis/Oscilator.h"
+
+/*
+ * same order as the ENV_IDX_* defines of easySynth
+ */
+enum VoiceEnvelope : uint8_t
+{
+    volumeEnvelope,
+    filterEnvelope,
+    pitchEnvelope,
+    modulationPitchEnvelope,  /* attack / decay to zero, sustain is the depth */
+    modulationFilterEnvelope, /* attack / decay to zero, sustain is the depth */
+    modulationMorphEnvelope,  /* attack / decay to zero, weight is the depth */
+    VoiceEnvelopeCount
+};
 
-template <size_t MaxNotes>
+/*
+ * the sound of a channel, shared by all voices playing on it;
+ * envelope increments are per step of 4 samples as in easySynth
+ */
 class ChannelSetting
 {
+public:
+    static const size_t Oscillators = MAX_POLY_VOICES_PER_OSC;
+
 private:
     float soundFiltReso;
     float soundNoiseLevel;
@@ -58,13 +81,6 @@ private:
     /* morph */
     float morph;
     float morph_lfo;
-    /* mono mode variables */
-    bool mono;
-
-    float portAdd;
-    float port;
-    float noteA;
-    float noteB;
     float modulation;
 
     
@@ -75,8 +91,10 @@ private:
     Synthesis::AsmrEnvelope adsr_mof;
     Synthesis::AsmrEnvelope adsr_mph;
 
-    uint32_t noteCnt;
-    std::array<Midi::MidiNote, MaxNotes> notes;
+    /*
+     * store configuration for three different oscillators
+     */
+    Synthesis::OscilatorConfig oscCfg[Oscillators];
     
     public:
     ChannelSetting():
@@ -90,22 +108,58 @@ private:
         pitchMultiplier(1.0f),
         morph(0.0f),
         morph_lfo(0.0f),
-        mono(false),
-        portAdd(0.01f), /*!< speed of portamento */
-        port(1.0f),
-        noteA(0),
-        noteB(0),
+        modulation(0.0f),
         
         adsr_vol(1.0f, 0.25f, 1.0f, 0.01f),
         adsr_fil(1.0f, 0.25f, 1.0f, 0.01f),
         adsr_pit(1.0f, 0.25f, 1.0f, 0.01f),
         adsr_mod(1.0f, 0.25f, 1.0f, 0.01f),
         adsr_mof(1.0f, 0.25f, 1.0f, 0.01f),
-        adsr_mph(1.0f, 0.25f, 1.0f, 0.01f),
-        noteCnt(0)
-    {}
-    /*
-     * store configuration for three different oscillators
-     */
-    // synth_osc_cfg_s oscCfg[3];
+        adsr_mph(1.0f, 0.25f, 1.0f, 0.01f)
+    {
+        /* one saw to start with, the other oscillators are silent */
+        oscCfg[0].setVolume(1.0f);
+    }
+
+    Synthesis::AdsrEnvelope &envelope(VoiceEnvelope e)
+    {
+        return const_cast<Synthesis::AdsrEnvelope &>(static_cast<const ChannelSetting &>(*this).envelope(e));
+    }
+    const Synthesis::AdsrEnvelope &envelope(VoiceEnvelope e) const
+    {
+        switch (e)
+        {
+        case volumeEnvelope:
+            return adsr_vol;
+        case filterEnvelope:
+            return adsr_fil;
+        case pitchEnvelope:
+            return adsr_pit;
+        case modulationPitchEnvelope:
+            return adsr_mod;
+        case modulationFilterEnvelope:
+            return adsr_mof;
+        default:
+            return adsr_mph;
+        }
+    }
+
+    inline Synthesis::OscilatorConfig &oscillator(size_t index) { return oscCfg[index]; }
+    inline const Synthesis::OscilatorConfig &oscillator(size_t index) const { return oscCfg[index]; }
+
+    inline float filterResonance() const { return soundFiltReso; }
+    inline void setFilterResonance(float value) { soundFiltReso = value; }
+    inline float morphAmount() const { return morph; }
+    inline void setMorphAmount(float value) { morph = value; }
+    inline float morphLfo() const { return morph_lfo; }
+    inline void setMorphLfo(float value) { morph_lfo = value; }
+    /* current value of the channel's modulation oscillator */
+    inline float modulationValue() const { return modulation; }
+    inline void setModulationValue(float value) { modulation = value; }
+    /* pitch bend, modulation and portamento as one frequency ratio */
+    inline float pitchRatio() const { return pitchMultiplier; }
+    inline void setPitchRatio(float value) { pitchMultiplier = value; }
 };
+
+/* what Synth keeps per part, mono note handling lives in MonoVoice */
+typedef ChannelSetting Patch;
@@ -0,0 +1,259 @@
+/**
+ * @file MonoVoice.h
+ *
+ * @brief   Note stack, note priority and portamento of a monophonic channel
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <cstddef>
+#include <math.h>
+#include "config.h"
+
+enum class NotePriority : uint8_t
+{
+    last,
+    high,
+    low
+};
+
+enum class GlideMode : uint8_t
+{
+    off,
+    linear,     /* constant time whatever the interval */
+    exponential /* fast at first, settles on the target */
+};
+
+/*
+ * Decides which held note a mono channel sounds and glides its pitch.
+ * The pitch is kept as a phase increment (the NotePlayer oscillator step) and
+ * moved once per block by glide(); the engine plays the result on one voice
+ * reserved for the channel, outside of VoiceAllocator.
+ *
+ * noteOn() / noteOff() return what the engine has to do with that voice:
+ * start (envelopes from the beginning), legato (new pitch, envelopes keep running)
+ * or release.
+ */
+template <size_t MaxNotes = NOTE_STACK_MAX, size_t BufferLength = SAMPLE_BUFFER_SIZE>
+class MonoVoice
+{
+public:
+    enum class Action : uint8_t
+    {
+        none,
+        start,
+        legato,
+        release
+    };
+
+    const float DefaultGlideTime = 0.05f;
+
+private:
+    /* held notes in the order they were pressed */
+    uint8_t _notes[MaxNotes];
+    uint8_t _velocities[MaxNotes];
+    size_t _count;
+
+    NotePriority _priority;
+    GlideMode _glideMode;
+    bool _legato;
+    bool _sounding;
+    float _glideBlocks;
+
+    int _note;
+    uint8_t _velocity;
+    float _increment;
+    float _target;
+    float _step;
+
+    static inline float incrementOf(float frequency)
+    {
+        return frequency / (float)SAMPLE_RATE * 4294967296.0f;
+    }
+
+    /*
+     * the held note the priority selects
+     */
+    size_t select() const
+    {
+        size_t best = _count - 1;
+        for (size_t i = 0; i < _count; i++)
+        {
+            if ((_priority == NotePriority::high && _notes[i] > _notes[best]) ||
+                (_priority == NotePriority::low && _notes[i] < _notes[best]))
+            {
+                best = i;
+            }
+        }
+        return best;
+    }
+
+    Action moveTo(uint8_t note, uint8_t velocity, float frequency)
+    {
+        const bool playing = _note >= 0;
+        _note = note;
+        _velocity = velocity;
+        _target = incrementOf(frequency);
+        if (_glideMode == GlideMode::off || !_sounding)
+        {
+            _increment = _target;
+        }
+        _step = (_target - _increment) / _glideBlocks;
+        if (playing && _legato)
+        {
+            return Action::legato;
+        }
+        _sounding = true;
+        return Action::start;
+    }
+
+public:
+    MonoVoice() : _count(0),
+                  _priority(NotePriority::last),
+                  _glideMode(GlideMode::off),
+                  _legato(true),
+                  _sounding(false),
+                  _note(-1),
+                  _velocity(0),
+                  _increment(0.0f),
+                  _target(0.0f),
+                  _step(0.0f)
+    {
+        setGlideTime(DefaultGlideTime);
+    }
+
+    /*
+     * @param frequency pitch of the note, the caller applies tuning and pitch bend
+     */
+    Action noteOn(uint8_t note, uint8_t velocity, float frequency)
+    {
+        for (size_t i = 0; i < _count; i++)
+        {
+            if (_notes[i] == note)
+            {
+                // pressed again, moves to the top of the stack
+                for (; i + 1 < _count; i++)
+                {
+                    _notes[i] = _notes[i + 1];
+                    _velocities[i] = _velocities[i + 1];
+                }
+                _count--;
+                break;
+            }
+        }
+        if (_count == MaxNotes)
+        {
+            // full, the oldest note is forgotten
+            for (size_t i = 0; i + 1 < _count; i++)
+            {
+                _notes[i] = _notes[i + 1];
+                _velocities[i] = _velocities[i + 1];
+            }
+            _count--;
+        }
+        _notes[_count] = note;
+        _velocities[_count] = velocity;
+        _count++;
+
+        if (_note >= 0 && select() != _count - 1)
+        {
+            // a held note has priority over the new one
+            return Action::none;
+        }
+        return moveTo(note, velocity, frequency);
+    }
+
+    /*
+     * @param frequencyOf callable returning the pitch of a note number, used when falling back to a held note
+     */
+    template <class F>
+    Action noteOff(uint8_t note, F frequencyOf)
+    {
+        size_t i = 0;
+        while (i < _count && _notes[i] != note)
+        {
+            i++;
+        }
+        if (i == _count)
+        {
+            return Action::none;
+        }
+        for (; i + 1 < _count; i++)
+        {
+            _notes[i] = _notes[i + 1];
+            _velocities[i] = _velocities[i + 1];
+        }
+        _count--;
+
+        if (note != _note)
+        {
+            return Action::none;
+        }
+        if (_count == 0)
+        {
+            _note = -1;
+            return Action::release;
+        }
+        const size_t next = select();
+        return moveTo(_notes[next], _velocities[next], frequencyOf(_notes[next]));
+    }
+
+    /*
+     * advances the glide by one block, returns the phase increment to play it with
+     */
+    float glide()
+    {
+        if (_increment != _target)
+        {
+            if (_glideMode == GlideMode::exponential)
+            {
+                _increment += (_target - _increment) / _glideBlocks;
+                // close enough to not hear the difference (< 0.2 cent)
+                if (fabsf(_target - _increment) < _target * 0.0001f)
+                {
+                    _increment = _target;
+                }
+            }
+            else
+            {
+                _increment += _step;
+                if ((_step > 0.0f && _increment > _target) || (_step < 0.0f && _increment < _target) || _step == 0.0f)
+                {
+                    _increment = _target;
+                }
+            }
+        }
+        return _increment;
+    }
+
+    /*
+     * the voice finished its release
+     */
+    inline void ended() { _sounding = false; }
+
+    void reset()
+    {
+        _count = 0;
+        _note = -1;
+        _sounding = false;
+    }
+
+    inline void setPriority(NotePriority priority) { _priority = priority; }
+    inline void setLegato(bool legato) { _legato = legato; }
+    inline void setGlide(GlideMode mode) { _glideMode = mode; }
+
+    /*
+     * linear: time of the whole glide, exponential: time constant
+     */
+    void setGlideTime(float seconds)
+    {
+        const float blocks = seconds * (float)SAMPLE_RATE / (float)BufferLength;
+        _glideBlocks = blocks < 1.0f ? 1.0f : blocks;
+    }
+
+    inline int note() const { return _note; }
+    inline uint8_t velocity() const { return _velocity; }
+    inline float increment() const { return _increment; }
+    inline size_t heldCount() const { return _count; }
+};
@@ -1,82 +1,518 @@
-/*
- * Copyright (c) 2022 Marcel Licence
- *
- * This program is free software: you can redistribute it and/or modify
- * it under the terms of the GNU General Public License as published by
- * the Free Software Foundation, either version 3 of the License, or
- * (at your option) any later version.
- *
- * This program is distributed in the hope that it will be useful,
- * but WITHOUT ANY WARRANTY; without even the implied warranty of
- * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
- * GNU General Public License for more details.
+/**
+ * @file NotePlayer.h
  *
- * You should have received a copy of the GNU General Public License
- * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * @brief   Voice pool stored as structure of arrays
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <cstddef>
+#include <math.h>
+#include "config.h"
+#include "ChannelSetting.h"
+#include "../../lib/Midi/MidiEvent.h"
+#include "../../lib/Synthesis/Envelope.h"
+#include "../../lib/Synthesis/Filter.h"
+#include "../../lib/Synthesis/Oscilator.h"
+#include "../../lib/Synthesis/WaveForms.h"
+
+/*
+ * All voices of the engine with their state kept per quantity instead of per voice:
+ * envelope levels of all voices together, all oscillator phases together, all filter
+ * states together. A block is rendered stage by stage (envelopes, pitch, filter
+ * coefficients, oscillators, filters, mix), each stage one loop over the compact list
+ * of active voices, so the loops run over contiguous arrays. A block can be rendered
+ * in several spans with notes started or released in between.
  *
- * Dieses Programm ist Freie Software: Sie können es unter den Bedingungen
- * der GNU General Public License, wie von der Free Software Foundation,
- * Version 3 der Lizenz oder (nach Ihrer Wahl) jeder neueren
- * veröffentlichten Version, weiter verteilen und/oder modifizieren.
+ * The sound is the one of easySynth: the per voice math is the one of the Synthesis
+ * primitives (AdsrEnvelope / AsmrEnvelope steps every 4 samples, LowPassFilterCoefficent
+ * from the smoothed filter control every 32 samples, Oscilator wave tables with morph),
+ * run on state kept here per voice. The settings come from the channel's ChannelSetting.
  *
- * Dieses Programm wird in der Hoffnung bereitgestellt, dass es nützlich sein wird, jedoch
- * OHNE JEDE GEWÄHR,; sogar ohne die implizite
- * Gewähr der MARKTFÄHIGKEIT oder EIGNUNG FÜR EINEN BESTIMMTEN ZWECK.
- * Siehe die GNU General Public License für weitere Einzelheiten.
+ * Voice numbers are the ones handed out by VoiceAllocator.
  *
- * Sie sollten eine Kopie der GNU General Public License zusammen mit diesem
- * Programm erhalten haben. Wenn nicht, siehe <https://www.gnu.org/licenses/>.
+ * Once per rendered span every voice's gain (volume envelope x velocity x channel volume)
+ * is checked against the cull threshold. Inaudible voices in release are retired at once,
+ * other inaudible voices only run their envelopes and skip oscillator, filter and mix until
+ * they come back above the threshold.
  */
+template <size_t MaxVoices = MAX_POLY_VOICE, size_t BufferLength = SAMPLE_BUFFER_SIZE>
+class NotePlayer
+{
+    static_assert(MaxVoices < 255, "voice numbers are stored as bytes");
 
-/**
- * @file easySynth.ino
- * @author Marcel Licence
- * @date 17.12.2021
- *
- * @brief   This file contains a simple implementation for a polyphonic synthesizer
- */
+public:
+    static const size_t Oscillators = Patch::Oscillators;
+    /* -80 dB */
+    const float DefaultCullThreshold = 0.0001f;
+    /* voice mix level of easySynth */
+    const float OutputGain = 0.4f * 0.25f * (1.0f / 3.0f);
 
-#include <stdint.h>
-#include "../lib/Synthesis.h"
-#include "../lib/Midi.h"
+private:
+    typedef Synthesis::Oscilator<BufferLength, 1> Oscilator;
+    typedef Synthesis::Filter<BufferLength> Filter;
 
-#pragma once
+    /* envelopes step every 4 samples, the filter control every 32, counted across spans */
+    static const uint32_t EnvelopeInterval = 4;
+    static const uint32_t FilterInterval = 32;
 
+    /* active list */
+    uint8_t _active[MaxVoices];
+    uint8_t _activeSlot[MaxVoices];
+    size_t _activeCount;
+    /* active voices above the cull threshold, rebuilt every span */
+    uint8_t _audible[MaxVoices];
+    size_t _audibleCount;
+    float _cullThreshold;
+    uint32_t _culled;
+    float _channelVolume[Midi::Constants::MaxChannels];
+    uint16_t _mixedChannels;
+    /* samples rendered modulo FilterInterval, places the control steps in a span */
+    uint32_t _position;
+    Synthesis::WaveForms::WaveForm *_sine;
 
-template <size_t BufferLength = 48>
-class NotePlayer
-{
-    Synthesis::StereoSampleBuffer& buffer;
+    /* per voice */
+    const Patch *_settings[MaxVoices];
+    uint8_t _channel[MaxVoices];
+    float _velocity[MaxVoices];
+    float _baseIncrement[MaxVoices];
+    float _pitchMod[MaxVoices];
+    float _morph[MaxVoices];
+    float _gain[MaxVoices];
+    float _targetGain[MaxVoices];
+    float _fadeFrom[MaxVoices];
+    float _fadeTo[MaxVoices];
+    bool _ended[MaxVoices];
+
+    /* oscillators */
+    uint32_t _samplePos[Oscillators][MaxVoices];
+    uint32_t _increment[Oscillators][MaxVoices];
+
+    /* envelopes */
+    float _ctrl[VoiceEnvelopeCount][MaxVoices];
+    Synthesis::EnvelopePhase _phase[VoiceEnvelopeCount][MaxVoices];
+
+    /* filter control, coefficients and state */
+    float _filterControl[MaxVoices];
+    Synthesis::FilterCoefficent _coefficent[MaxVoices];
+    float _w[MaxVoices][2];
+
+    float _signal[MaxVoices][BufferLength];
+
+    inline void activate(uint8_t v)
+    {
+        if (_activeSlot[v] == 0xFF)
+        {
+            _activeSlot[v] = (uint8_t)_activeCount;
+            _active[_activeCount++] = v;
+        }
+    }
+
+    inline void deactivate(uint8_t v)
+    {
+        const uint8_t slot = _activeSlot[v];
+        if (slot != 0xFF)
+        {
+            const uint8_t last = _active[--_activeCount];
+            _active[slot] = last;
+            _activeSlot[last] = slot;
+            _activeSlot[v] = 0xFF;
+        }
+    }
+
+    /*
+     * cutoff from the filter envelope and its modulation, smoothed like easySynth's f_control_sign_slow
+     */
+    inline void stepFilterControl(uint8_t v)
+    {
+        const Patch &s = *_settings[v];
+        float ff = _ctrl[filterEnvelope][v];
+        ff += s.modulationValue() * _ctrl[modulationFilterEnvelope][v] * s.envelope(modulationFilterEnvelope).getSustain();
+        ff = ff > 1.0f ? 1.0f : (ff < 0.0f ? 0.0f : ff);
+        _filterControl[v] = 0.05f * ff + 0.95f * _filterControl[v];
+    }
+
+    inline void calculateFilter(uint8_t v)
+    {
+        _coefficent[v] = Synthesis::LowPassFilterCoefficent(_filterControl[v], _settings[v]->filterResonance(), _sine);
+    }
+
+    inline float fadeAt(uint8_t v, size_t n) const
+    {
+        return _fadeFrom[v] + (_fadeTo[v] - _fadeFrom[v]) * (float)n / (float)BufferLength;
+    }
+
+    void processEnvelopes(size_t steps)
+    {
+        for (size_t e = 0; e < VoiceEnvelopeCount; e++)
+        {
+            float *ctrl = _ctrl[e];
+            Synthesis::EnvelopePhase *phase = _phase[e];
+            const bool modulation = e >= modulationPitchEnvelope;
+            for (size_t i = 0; i < _activeCount; i++)
+            {
+                const uint8_t v = _active[i];
+                const Synthesis::AdsrEnvelope &s = _settings[v]->envelope((VoiceEnvelope)e);
+                const float attack = s.getAttack();
+                const float decay = s.getDecay();
+                const float sustain = s.getSustain();
+                const float release = s.getRelease();
+                bool running = true;
+                for (size_t n = 0; n < steps; n++)
+                {
+                    running = modulation ? Synthesis::AsmrEnvelope::step(attack, decay, release, ctrl[v], phase[v])
+                                         : Synthesis::AdsrEnvelope::step(attack, decay, sustain, release, ctrl[v], phase[v]);
+                }
+                if (e == volumeEnvelope && !running)
+                {
+                    _ended[v] = true;
+                }
+            }
+        }
+    }
+
+    void updateControls()
+    {
+        const float *pitch = _ctrl[pitchEnvelope];
+        const float *pitchModulation = _ctrl[modulationPitchEnvelope];
+        const float *morph = _ctrl[modulationMorphEnvelope];
+        const float *volume = _ctrl[volumeEnvelope];
+        for (size_t i = 0; i < _activeCount; i++)
+        {
+            const uint8_t v = _active[i];
+            const Patch &s = *_settings[v];
+            float pitchMod = 1.0f + pitch[v] * s.envelope(pitchEnvelope).getWeight();
+            pitchMod *= powf(2.0f, s.modulationValue() * pitchModulation[v] * s.envelope(modulationPitchEnvelope).getSustain());
+            _pitchMod[v] = pitchMod;
+            _morph[v] = s.morphAmount() + morph[v] * s.envelope(modulationMorphEnvelope).getWeight() + s.morphLfo() * s.modulationValue() * 2.0f;
+            const float increment = s.pitchRatio() * _baseIncrement[v] * pitchMod;
+            for (size_t o = 0; o < Oscillators; o++)
+            {
+                const Synthesis::OscilatorConfig &oscillator = s.oscillator(o);
+                _increment[o][v] = (uint32_t)(oscillator.getPitchOctave() * oscillator.getPitch() * increment);
+            }
+            _gain[v] = _targetGain[v];
+            _targetGain[v] = volume[v] * _velocity[v] * _channelVolume[_channel[v]];
+        }
+    }
+
+    /*
+     * builds the audible list; releases that fell below the threshold end here
+     */
+    void cull(size_t offset, size_t length)
+    {
+        _audibleCount = 0;
+        for (size_t i = 0; i < _activeCount; i++)
+        {
+            const uint8_t v = _active[i];
+            // the ramp starts at the previous gain, the voice is silent only if both ends are
+            if (_targetGain[v] >= _cullThreshold || _gain[v] * fadeAt(v, offset) >= _cullThreshold)
+            {
+                _audible[_audibleCount++] = v;
+            }
+            else if (_phase[volumeEnvelope][v] == Synthesis::EnvelopePhase::release)
+            {
+                _ended[v] = true;
+                _culled++;
+            }
+            else
+            {
+                // keep the phases running so the voice comes back where it would have been
+                for (size_t o = 0; o < Oscillators; o++)
+                {
+                    _samplePos[o][v] += _increment[o][v] * (uint32_t)length;
+                }
+            }
+        }
+    }
+
+    void updateFilters(size_t steps)
+    {
+        for (size_t i = 0; i < _audibleCount; i++)
+        {
+            const uint8_t v = _audible[i];
+            for (size_t n = 0; n < steps; n++)
+            {
+                stepFilterControl(v);
+            }
+            calculateFilter(v);
+        }
+    }
+
+    void renderOscillators(size_t length)
+    {
+        for (size_t i = 0; i < _audibleCount; i++)
+        {
+            const uint8_t v = _audible[i];
+            const Patch &s = *_settings[v];
+            float *out = _signal[v];
+            for (size_t n = 0; n < length; n++)
+            {
+                out[n] = 0.0f;
+            }
+            const float morph = _morph[v];
+            for (size_t o = 0; o < Oscillators; o++)
+            {
+                const Synthesis::OscilatorConfig &oscillator = s.oscillator(o);
+                if (oscillator.getVolume() == 0.0f)
+                {
+                    continue;
+                }
+                uint32_t samplePos = _samplePos[o][v];
+                const uint32_t increment = _increment[o][v];
+                for (size_t n = 0; n < length; n++)
+                {
+                    out[n] += Oscilator::step(samplePos, increment, morph, oscillator);
+                }
+                _samplePos[o][v] = samplePos;
+            }
+        }
+    }
+
+    void applyFilters(size_t length)
+    {
+        for (size_t i = 0; i < _audibleCount; i++)
+        {
+            const uint8_t v = _audible[i];
+            float *signal = _signal[v];
+            const Synthesis::FilterCoefficent coefficent = _coefficent[v];
+            float w[2] = {_w[v][0], _w[v][1]};
+            for (size_t n = 0; n < length; n++)
+            {
+                signal[n] = Filter::step(coefficent, w, signal[n]);
+            }
+            _w[v][0] = w[0];
+            _w[v][1] = w[1];
+        }
+    }
+
+    void mix(size_t offset, size_t length, float *const *left, float *const *right)
+    {
+        const float step = 1.0f / (float)length;
+        for (size_t i = 0; i < _audibleCount; i++)
+        {
+            const uint8_t v = _audible[i];
+            const uint8_t channel = _channel[v];
+            float *outLeft = left[channel] + offset;
+            float *outRight = right[channel] + offset;
+            _mixedChannels |= (uint16_t)(1u << channel);
+            const float *signal = _signal[v];
+            /* volume ramps over the span, the steal fade over the whole block */
+            const float from = _gain[v] * fadeAt(v, offset) * OutputGain;
+            const float delta = (_targetGain[v] * fadeAt(v, offset + length) * OutputGain - from) * step;
+            float gain = from;
+            for (size_t n = 0; n < length; n++)
+            {
+                const float s = signal[n] * gain;
+                outLeft[n] += s;
+                outRight[n] += s;
+                gain += delta;
+            }
+        }
+    }
+
+public:
+    NotePlayer() : _activeCount(0),
+                   _audibleCount(0),
+                   _cullThreshold(DefaultCullThreshold),
+                   _culled(0),
+                   _mixedChannels(0),
+                   _position(0),
+                   _sine(&Synthesis::WaveForms::All<>::sine())
+    {
+        for (size_t c = 0; c < Midi::Constants::MaxChannels; c++)
+        {
+            _channelVolume[c] = 1.0f;
+        }
+        for (size_t v = 0; v < MaxVoices; v++)
+        {
+            _activeSlot[v] = 0xFF;
+            _settings[v] = nullptr;
+            _channel[v] = 0;
+            _gain[v] = 0.0f;
+            _targetGain[v] = 0.0f;
+            _fadeFrom[v] = 1.0f;
+            _fadeTo[v] = 1.0f;
+            _ended[v] = true;
+            _filterControl[v] = 0.0f;
+            _w[v][0] = 0.0f;
+            _w[v][1] = 0.0f;
+            for (size_t o = 0; o < Oscillators; o++)
+            {
+                _samplePos[o][v] = 0;
+                _increment[o][v] = 0;
+            }
+            for (size_t e = 0; e < VoiceEnvelopeCount; e++)
+            {
+                _ctrl[e][v] = 0.0f;
+                _phase[e][v] = Synthesis::EnvelopePhase::release;
+            }
+        }
+    }
 
-    float velocity;
-    bool active;
-    // adsr_phaseT phase;
+    /*
+     * starts a note; a retriggered voice keeps its phase, filter state and envelope levels
+     * so it continues from where it is instead of clicking
+     */
+    void start(uint8_t v, uint8_t channel, const Patch &settings, float frequency, float velocity, bool retrigger = false)
+    {
+        _settings[v] = &settings;
+        _channel[v] = channel;
+        _velocity[v] = velocity;
+        _baseIncrement[v] = frequency / (float)SAMPLE_RATE * 4294967296.0f;
+        _fadeFrom[v] = 1.0f;
+        _fadeTo[v] = 1.0f;
+        _ended[v] = false;
+        for (size_t e = 0; e < VoiceEnvelopeCount; e++)
+        {
+            if (retrigger)
+            {
+                _phase[e][v] = Synthesis::EnvelopePhase::attack;
+            }
+            else
+            {
+                Synthesis::AdsrEnvelope::start(settings.envelope((VoiceEnvelope)e).getAttack(), _ctrl[e][v], _phase[e][v]);
+            }
+        }
+        if (!retrigger)
+        {
+            for (size_t o = 0; o < Oscillators; o++)
+            {
+                _samplePos[o][v] = 0;
+            }
+            _w[v][0] = 0.0f;
+            _w[v][1] = 0.0f;
+            _gain[v] = 0.0f;
+            _targetGain[v] = 0.0f;
+            _filterControl[v] = _ctrl[filterEnvelope][v];
+            calculateFilter(v);
+        }
+        activate(v);
+    }
 
-    uint8_t midiCh;
-    uint8_t midiNote;
+    void release(uint8_t v)
+    {
+        for (size_t e = 0; e < VoiceEnvelopeCount; e++)
+        {
+            _phase[e][v] = Synthesis::EnvelopePhase::release;
+        }
+    }
 
-    // float control_sign;
-    float out_level;
+    /*
+     * stops rendering the voice at once
+     */
+    void stop(uint8_t v)
+    {
+        for (size_t e = 0; e < VoiceEnvelopeCount; e++)
+        {
+            _phase[e][v] = Synthesis::EnvelopePhase::release;
+            _ctrl[e][v] = 0.0f;
+        }
+        _ended[v] = true;
+        deactivate(v);
+    }
 
-    float pitch_mod;
+    /*
+     * gain ramp applied on top of the volume during the next block, for stolen voices
+     */
+    inline void setFade(uint8_t v, float from, float to)
+    {
+        _fadeFrom[v] = from;
+        _fadeTo[v] = to;
+    }
 
-    float morph; /* current morph value per voice */
+    /*
+     * new frequency without restarting, for glides
+     */
+    inline void setFrequency(uint8_t v, float frequency)
+    {
+        _baseIncrement[v] = frequency / (float)SAMPLE_RATE * 4294967296.0f;
+    }
 
-    
-    Synthesis::Filter filterL;
-    Synthesis::Filter filterR;
+    /*
+     * oscillator step per sample as a fraction of 2^32, before pitch envelopes
+     */
+    inline void setIncrement(uint8_t v, float increment)
+    {
+        _baseIncrement[v] = increment;
+    }
 
+    /*
+     * adds one block of all active voices to left and right,
+     * ended(voice) is called for every voice whose volume envelope has finished
+     */
+    template <class Ended>
+    void render(float *left, float *right, Ended ended)
+    {
+        float *lefts[Midi::Constants::MaxChannels];
+        float *rights[Midi::Constants::MaxChannels];
+        for (size_t c = 0; c < Midi::Constants::MaxChannels; c++)
+        {
+            lefts[c] = left;
+            rights[c] = right;
+        }
+        render(0, BufferLength, lefts, rights, ended);
+    }
 
-    float f_control_sign_slow;
+    /*
+     * same with one output per MIDI channel, mixedChannels() tells which ones were written
+     */
+    template <class Ended>
+    void render(float *const *left, float *const *right, Ended ended)
+    {
+        render(0, BufferLength, left, right, ended);
+    }
 
-    Synthesis::AdsrEnvelope _volume;
-    Synthesis::AdsrEnvelope _filter;
-    Synthesis::AdsrEnvelope _pitch;
-    Synthesis::AsmrEnvelope _modulation
-    Synthesis::AsmrEnvelope _modulationF;
-    Synthesis::AsmrEnvelope _mph;
+    /*
+     * adds samples offset .. offset + length - 1 of the block, so events can take effect
+     * between two spans (see Midi::MidiBlockScheduler); the spans of a block start at 0 and
+     * follow each other, left and right point to the start of the block
+     */
+    template <class Ended>
+    void render(size_t offset, size_t length, float *const *left, float *const *right, Ended ended)
+    {
+        if (offset == 0)
+        {
+            _mixedChannels = 0;
+        }
+        const uint32_t end = _position + (uint32_t)length;
+        processEnvelopes(end / EnvelopeInterval - _position / EnvelopeInterval);
+        updateControls();
+        cull(offset, length);
+        updateFilters(end / FilterInterval - _position / FilterInterval);
+        _position = end % FilterInterval;
+        renderOscillators(length);
+        applyFilters(length);
+        mix(offset, length, left, right);
 
+        for (size_t i = _activeCount; i-- > 0;)
+        {
+            const uint8_t v = _active[i];
+            if (_ended[v])
+            {
+                deactivate(v);
+                ended(v);
+            }
+        }
+    }
 
+    /*
+     * channel volume (CC 7 / 11) applied to all voices of the channel
+     */
+    inline void setChannelVolume(uint8_t channel, float volume) { _channelVolume[channel] = volume; }
+    inline float channelVolume(uint8_t channel) const { return _channelVolume[channel]; }
+    inline void setCullThreshold(float threshold) { _cullThreshold = threshold; }
 
-    struct ChannelSetting& cfg;
-};
\ No newline at end of file
+    inline bool isActive(uint8_t v) const { return _activeSlot[v] != 0xFF; }
+    inline size_t activeCount() const { return _activeCount; }
+    inline size_t audibleCount() const { return _audibleCount; }
+    /* bit per channel that got samples in the last block */
+    inline uint16_t mixedChannels() const { return _mixedChannels; }
+    /* releases ended early because they were inaudible */
+    inline uint32_t culledVoices() const { return _culled; }
+    inline uint8_t channel(uint8_t v) const { return _channel[v]; }
+    inline float level(uint8_t v) const { return _targetGain[v]; }
+    inline float envelopeLevel(VoiceEnvelope e, uint8_t v) const { return _ctrl[e][v]; }
+    inline bool isReleasing(uint8_t v) const { return isActive(v) && _phase[volumeEnvelope][v] == Synthesis::EnvelopePhase::release; }
+};
@@ -0,0 +1,195 @@
+/**
+ * @file PolyphonyGovernor.h
+ *
+ * @brief   Adapts the voice limit to the CPU time left in each block
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <cstddef>
+#include <chrono>
+#include "config.h"
+#include "VoiceAllocator.h"
+
+/*
+ * Times every block against its deadline (SAMPLE_BUFFER_SIZE / SAMPLE_RATE, about 1.09 ms)
+ * and moves the allocator's voice limit so the engine uses the CPU it has without underruns.
+ *
+ * The load estimate follows increases at once and decreases slowly. Above the high mark
+ * the limit drops to the voice count that would meet the target load and the quietest
+ * voices are faded out right away; after a run of blocks below the low mark the limit
+ * grows again by one voice.
+ *
+ *   governor.beginBlock();
+ *   ... render ...
+ *   governor.endBlock();
+ */
+template <class Allocator>
+class PolyphonyGovernor
+{
+public:
+    typedef uint32_t (*Clock)();
+
+    static uint32_t steadyMicros()
+    {
+        return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    const float DefaultTargetLoad = 0.75f;
+    const float DefaultHighLoad = 0.85f;
+    const float DefaultLowLoad = 0.6f;
+    const uint32_t DefaultGrowBlocks = 32;
+    const size_t DefaultMinimumVoices = 2;
+    /* voices faded per block when shedding, more would be audible as a dropout */
+    const size_t MaxShedPerBlock = 4;
+
+private:
+    Allocator &_voices;
+    Clock _clock;
+    float _deadline;
+    uint32_t _start;
+
+    float _load;
+    float _lastLoad;
+    float _peakLoad;
+    float _targetLoad;
+    float _highLoad;
+    float _lowLoad;
+    uint32_t _growBlocks;
+    uint32_t _quietBlocks;
+    size_t _minimumVoices;
+    size_t _maximumVoices;
+    uint32_t _overruns;
+    uint32_t _shed;
+
+    void shed(size_t limit)
+    {
+        _voices.setVoiceLimit(limit);
+        size_t count = 0;
+        while (_voices.activeCount() > _voices.voiceLimit() && count < MaxShedPerBlock)
+        {
+            if (_voices.stealOne(StealPolicy::quietest) == Allocator::NoVoice)
+            {
+                break;
+            }
+            count++;
+        }
+        _shed += count;
+    }
+
+public:
+    /*
+     * @param deadlineMicros time available per block, SAMPLE_BUFFER_SIZE / SAMPLE_RATE by default
+     */
+    PolyphonyGovernor(Allocator &voices,
+                      float deadlineMicros = 1000000.0f * SAMPLE_BUFFER_SIZE / SAMPLE_RATE,
+                      Clock clock = steadyMicros) : _voices(voices),
+                                                    _clock(clock),
+                                                    _deadline(deadlineMicros),
+                                                    _start(0),
+                                                    _load(0.0f),
+                                                    _lastLoad(0.0f),
+                                                    _peakLoad(0.0f),
+                                                    _targetLoad(DefaultTargetLoad),
+                                                    _highLoad(DefaultHighLoad),
+                                                    _lowLoad(DefaultLowLoad),
+                                                    _growBlocks(DefaultGrowBlocks),
+                                                    _quietBlocks(0),
+                                                    _minimumVoices(DefaultMinimumVoices),
+                                                    _maximumVoices(voices.voiceLimit()),
+                                                    _overruns(0),
+                                                    _shed(0)
+    {
+    }
+
+    inline void beginBlock()
+    {
+        _start = _clock();
+    }
+
+    void endBlock()
+    {
+        const float elapsed = (float)(_clock() - _start);
+        const float load = elapsed / _deadline;
+        _lastLoad = load;
+        if (load > _peakLoad)
+        {
+            _peakLoad = load;
+        }
+        if (load > 1.0f)
+        {
+            _overruns++;
+        }
+        // fast attack, slow release
+        _load += (load - _load) * (load > _load ? 0.5f : 0.02f);
+
+        const size_t active = _voices.activeCount();
+        const size_t limit = _voices.voiceLimit();
+        if (_load > _highLoad && active > _minimumVoices)
+        {
+            size_t target = (size_t)((float)active * _targetLoad / _load);
+            if (target < _minimumVoices)
+            {
+                target = _minimumVoices;
+            }
+            if (target < limit)
+            {
+                shed(target);
+                // expected load with the voices that are left, so the next blocks do not shed again for the same peak
+                _load *= (float)target / (float)active;
+            }
+            else if (active > limit)
+            {
+                // the rest of an earlier cut, at most MaxShedPerBlock went per block
+                shed(limit);
+            }
+            _quietBlocks = 0;
+        }
+        else if (_load < _lowLoad && limit < _maximumVoices)
+        {
+            if (++_quietBlocks >= _growBlocks)
+            {
+                _voices.setVoiceLimit(limit + 1);
+                _quietBlocks = 0;
+            }
+        }
+        else
+        {
+            _quietBlocks = 0;
+            if (active > limit)
+            {
+                shed(limit);
+            }
+        }
+    }
+
+    /*
+     * load marks as fractions of the deadline
+     */
+    void setLoads(float target, float high, float low)
+    {
+        _targetLoad = target;
+        _highLoad = high;
+        _lowLoad = low;
+    }
+
+    void setVoiceRange(size_t minimum, size_t maximum)
+    {
+        _minimumVoices = minimum;
+        _maximumVoices = maximum;
+        _voices.setVoiceLimit(_voices.voiceLimit() > maximum ? maximum : _voices.voiceLimit());
+    }
+
+    /*
+     * telemetry
+     */
+    inline float load() const { return _load; }
+    inline float lastLoad() const { return _lastLoad; }
+    inline float headroom() const { return 1.0f - _load; }
+    inline float peakLoad() const { return _peakLoad; }
+    inline void resetPeak() { _peakLoad = 0.0f; }
+    inline size_t voiceLimit() const { return _voices.voiceLimit(); }
+    inline uint32_t overruns() const { return _overruns; }
+    inline uint32_t shedVoices() const { return _shed; }
+};
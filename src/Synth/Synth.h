@@ -1,6 +1,648 @@
+/**
+ * @file Synth.h
+ *
+ * @brief   Multitimbral engine: voice allocation, voice pool, effect send buses and effect chain
+ */
+
 #pragma once
 
+#include <stdint.h>
+#include <cstddef>
+#include <string.h>
+#include "config.h"
+#include "../../lib/Midi/StaticMidiMessageProcessor.h"
+#include "../../lib/Midi/MidiClock.h"
+#include "../../lib/Midi/MidiBlockScheduler.h"
+#include "VoiceAllocator.h"
+#include "PolyphonyGovernor.h"
+#include "NotePlayer.h"
+#include "MonoVoice.h"
+
+/*
+ * effect at the end of the chain, works in place on a stereo block
+ */
+class StereoEffect
+{
+public:
+    virtual void process(float *left, float *right, size_t length) = 0;
+    /* clears delay lines and filter states, called when the engine goes idle */
+    virtual void reset() {}
+};
+
+/*
+ * shared effects the channels send to, a bus effect outputs only its wet signal
+ */
+enum EffectBus : uint8_t
+{
+    reverbBus,
+    delayBus,
+    chorusBus,
+    EffectBusCount
+};
+
+/*
+ * Plays MIDI input on a pool of voices and runs the result through the effect chain.
+ *
+ * Every MIDI channel is a part with its own patch, voice quota and send levels
+ * (CC 91 reverb, CC 94 delay, CC 93 chorus). Voices are mixed per part; the parts are
+ * summed into the dry mix and, weighted by their sends, into one buffer per bus, so
+ * each bus effect runs once per block however many parts feed it. A bus nobody sends
+ * to is skipped once its tail has died away.
+ *
+ * When no voice is left and the output has stayed below the silence threshold for the
+ * hold time (long enough for delay repeats and reverb tails to die away) the engine goes
+ * idle: the effects are reset once and render() only clears the block and returns false
+ * until the next note or controller, without touching voices or effects. The output driver
+ * can check isIdle() and send its own zero block with skip() instead of calling render() at all.
+ *
+ * Events given to schedule() carry the engine sample time they are due at in the timestamp,
+ * sampleTime() is the time of the next block; render() splits the block there, so voices start
+ * and stop on the sample they were sent for. process() applies an event at once, on the next
+ * block boundary.
+ *
+ * MIDI clock and transport messages feed clock(), which tempo synced effects follow.
+ * They do not wake the engine; render() and skip() advance the clock by one block.
+ *
+ * Every rendered block is timed by governor() against its deadline; when the load gets
+ * too high the voice limit drops and the quietest voices fade out, and it grows back
+ * once there is headroom again. load(), headroom() and overruns() are its telemetry.
+ *
+ * A channel in mono mode (CC 126, back to poly with CC 127) plays on its own voice
+ * after the allocator's slots, driven by a MonoVoice: note priority, legato and
+ * portamento (CC 65 on/off, CC 5 time) without going through voice allocation.
+ */
+template <size_t MaxVoices = MAX_POLY_VOICE, size_t BufferLength = SAMPLE_BUFFER_SIZE, size_t MaxEffects = 4>
+class Synth : public Midi::StaticMidiMessageProcessor<Synth<MaxVoices, BufferLength, MaxEffects>>
+{
+public:
+    typedef VoiceAllocator<MaxVoices> Allocator;
+    typedef NotePlayer<Allocator::Slots + Midi::Constants::MaxChannels, BufferLength> Voices;
+    typedef MonoVoice<NOTE_STACK_MAX, BufferLength> Mono;
+    typedef Midi::MidiBlockScheduler<BufferLength> Scheduler;
+    typedef PolyphonyGovernor<Allocator> Governor;
+
+    /* -80 dB peak */
+    const float DefaultSilenceThreshold = 0.0001f;
+    /* one second of silence */
+    const uint32_t DefaultHoldBlocks = SAMPLE_RATE / BufferLength;
+
+private:
+    Allocator _allocator;
+    Governor _governor;
+    Voices _voices;
+    Patch _patch[Midi::Constants::MaxChannels];
+
+    float _partLeft[Midi::Constants::MaxChannels][BufferLength];
+    float _partRight[Midi::Constants::MaxChannels][BufferLength];
+    float *_partLefts[Midi::Constants::MaxChannels];
+    float *_partRights[Midi::Constants::MaxChannels];
+
+    StereoEffect *_bus[EffectBusCount];
+    float _busReturn[EffectBusCount];
+    float _send[Midi::Constants::MaxChannels][EffectBusCount];
+    float _busLeft[BufferLength];
+    float _busRight[BufferLength];
+    uint32_t _busSilentBlocks[EffectBusCount];
+    bool _busIdle[EffectBusCount];
+
+    Mono _mono[Midi::Constants::MaxChannels];
+    bool _monoMode[Midi::Constants::MaxChannels];
+    GlideMode _glideMode[Midi::Constants::MaxChannels];
+
+    StereoEffect *_effects[MaxEffects];
+    size_t _effectCount;
+
+    Midi::MidiClock _clock;
+    Scheduler _scheduler;
+    /* sample offset of the event being handled, 0 outside render() */
+    uint32_t _offset;
+
+    bool _idle;
+    uint32_t _silentBlocks;
+    uint32_t _holdBlocks;
+    float _silenceThreshold;
+
+    inline void wake()
+    {
+        _idle = false;
+        _silentBlocks = 0;
+    }
+
+    /* the scheduler renders the spans between events and hands the events back */
+    friend Scheduler;
+
+    static inline uint8_t monoVoice(uint8_t channel) { return (uint8_t)(Allocator::Slots + channel); }
+    static inline float frequencyOf(uint8_t note) { return Midi::MidiNote(note).frequency(); }
+
+    void apply(uint8_t channel, typename Mono::Action action)
+    {
+        const uint8_t v = monoVoice(channel);
+        Mono &mono = _mono[channel];
+        switch (action)
+        {
+        case Mono::Action::start:
+            _voices.start(v, channel, _patch[channel], frequencyOf((uint8_t)mono.note()), (float)mono.velocity() / 127.0f, _voices.isActive(v));
+            _voices.setIncrement(v, mono.increment());
+            break;
+        case Mono::Action::legato:
+            _voices.setIncrement(v, mono.increment());
+            break;
+        case Mono::Action::release:
+            _voices.release(v);
+            break;
+        default:
+            break;
+        }
+    }
+
+    void noteOff(uint8_t channel, uint8_t note)
+    {
+        if (_monoMode[channel])
+        {
+            apply(channel, _mono[channel].noteOff(note, frequencyOf));
+            return;
+        }
+        const uint8_t v = _allocator.noteOff(channel, note);
+        if (v != Allocator::NoVoice)
+        {
+            _voices.release(v);
+        }
+    }
+
+    /*
+     * stops fading voices that reach silence in this block, reports levels for the quietest policy
+     */
+    size_t prepareVoices(uint8_t *faded)
+    {
+        size_t count = 0;
+        for (uint8_t c = 0; c < Midi::Constants::MaxChannels; c++)
+        {
+            if (_voices.isActive(monoVoice(c)))
+            {
+                _voices.setIncrement(monoVoice(c), _mono[c].glide());
+            }
+        }
+        _allocator.forEachSounding([this, faded, &count](uint8_t v) {
+            if (_allocator.state(v) == VoiceState::fading)
+            {
+                const float to = _allocator.fadeGain(v, BufferLength);
+                _voices.setFade(v, _allocator.fadeGain(v), to);
+                if (to == 0.0f)
+                {
+                    faded[count++] = v;
+                }
+            }
+            else
+            {
+                _allocator.setLevel(v, _voices.level(v));
+            }
+        });
+        return count;
+    }
+
+    /*
+     * parts into the dry mix and the send buses, buses through their effects back into the mix
+     */
+    void mixParts(float *left, float *right)
+    {
+        const uint16_t parts = _voices.mixedChannels();
+        for (uint16_t bits = parts; bits != 0; bits &= bits - 1)
+        {
+            const size_t c = __builtin_ctz(bits);
+            for (size_t n = 0; n < BufferLength; n++)
+            {
+                left[n] += _partLeft[c][n];
+                right[n] += _partRight[c][n];
+            }
+        }
+
+        for (size_t b = 0; b < EffectBusCount; b++)
+        {
+            if (_bus[b] == nullptr)
+            {
+                continue;
+            }
+            bool fed = false;
+            for (uint16_t bits = parts; bits != 0; bits &= bits - 1)
+            {
+                const size_t c = __builtin_ctz(bits);
+                const float send = _send[c][b];
+                if (send <= 0.0f)
+                {
+                    continue;
+                }
+                if (!fed)
+                {
+                    memset(_busLeft, 0, sizeof(_busLeft));
+                    memset(_busRight, 0, sizeof(_busRight));
+                    fed = true;
+                }
+                for (size_t n = 0; n < BufferLength; n++)
+                {
+                    _busLeft[n] += _partLeft[c][n] * send;
+                    _busRight[n] += _partRight[c][n] * send;
+                }
+            }
+            if (!fed)
+            {
+                if (_busIdle[b])
+                {
+                    continue;
+                }
+                memset(_busLeft, 0, sizeof(_busLeft));
+                memset(_busRight, 0, sizeof(_busRight));
+            }
+
+            _bus[b]->process(_busLeft, _busRight, BufferLength);
+            const float level = _busReturn[b];
+            for (size_t n = 0; n < BufferLength; n++)
+            {
+                left[n] += _busLeft[n] * level;
+                right[n] += _busRight[n] * level;
+            }
+
+            if (!fed && silent(_busLeft, _busRight))
+            {
+                if (++_busSilentBlocks[b] >= _holdBlocks)
+                {
+                    _busIdle[b] = true;
+                    _bus[b]->reset();
+                }
+            }
+            else
+            {
+                _busSilentBlocks[b] = 0;
+                _busIdle[b] = false;
+            }
+        }
+
+        for (uint16_t bits = parts; bits != 0; bits &= bits - 1)
+        {
+            const size_t c = __builtin_ctz(bits);
+            memset(_partLeft[c], 0, sizeof(_partLeft[c]));
+            memset(_partRight[c], 0, sizeof(_partRight[c]));
+        }
+    }
+
+    bool silent(const float *left, const float *right) const
+    {
+        for (size_t n = 0; n < BufferLength; n++)
+        {
+            if (left[n] >= _silenceThreshold || left[n] <= -_silenceThreshold ||
+                right[n] >= _silenceThreshold || right[n] <= -_silenceThreshold)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void voiceEnded(uint8_t v)
+    {
+        if (v >= Allocator::Slots)
+        {
+            _mono[v - Allocator::Slots].ended();
+        }
+        else
+        {
+            _allocator.voiceEnded(v);
+        }
+    }
+
+    /*
+     * renders the voices between two scheduled events
+     */
+    void render(size_t offset, size_t length)
+    {
+        if (!_idle)
+        {
+            _voices.render(offset, length, _partLefts, _partRights, [this](uint8_t v) { voiceEnded(v); });
+        }
+    }
+
+    void handleEvent(const Midi::MidiEvent &event, size_t offset)
+    {
+        _offset = (uint32_t)offset;
+        this->process(event);
+        _offset = 0;
+    }
+
+public:
+    Synth() : _governor(_allocator, 1000000.0f * BufferLength / SAMPLE_RATE),
+              _effectCount(0),
+              _clock(SAMPLE_RATE),
+              _offset(0),
+              _idle(true),
+              _silentBlocks(0),
+              _holdBlocks(DefaultHoldBlocks),
+              _silenceThreshold(DefaultSilenceThreshold)
+    {
+        memset(_partLeft, 0, sizeof(_partLeft));
+        memset(_partRight, 0, sizeof(_partRight));
+        for (size_t c = 0; c < Midi::Constants::MaxChannels; c++)
+        {
+            _monoMode[c] = false;
+            _glideMode[c] = GlideMode::exponential;
+            _partLefts[c] = _partLeft[c];
+            _partRights[c] = _partRight[c];
+            for (size_t b = 0; b < EffectBusCount; b++)
+            {
+                _send[c][b] = 0.0f;
+            }
+        }
+        for (size_t b = 0; b < EffectBusCount; b++)
+        {
+            _bus[b] = nullptr;
+            _busReturn[b] = 1.0f;
+            _busSilentBlocks[b] = 0;
+            _busIdle[b] = true;
+        }
+    }
+
+    /*
+     * renders one block, returns false when the block is silence from the idle state
+     */
+    bool render(float *left, float *right)
+    {
+        memset(left, 0, BufferLength * sizeof(float));
+        memset(right, 0, BufferLength * sizeof(float));
+        if (isIdle())
+        {
+            skip();
+            return false;
+        }
+
+        _governor.beginBlock();
+        uint8_t faded[Allocator::Slots];
+        const size_t fadedCount = _idle ? 0 : prepareVoices(faded);
+        // a scheduled note wakes the engine in the middle of the block, the spans before it stay silent
+        _scheduler.render(*this);
+        if (_idle)
+        {
+            // no voices to shed, but every beginBlock() needs its endBlock() so the load reading stays current
+            _governor.endBlock();
+            _clock.advance(BufferLength);
+            return false;
+        }
+        for (size_t i = 0; i < fadedCount; i++)
+        {
+            _voices.stop(faded[i]);
+        }
+        _allocator.endBlock(BufferLength);
+        mixParts(left, right);
+
+        for (size_t e = 0; e < _effectCount; e++)
+        {
+            _effects[e]->process(left, right, BufferLength);
+        }
+
+        const uint32_t shed = _governor.shedVoices();
+        _governor.endBlock();
+        if (_governor.shedVoices() != shed)
+        {
+            // shed without a spare slot to fade on, the voice is free already and must go quiet
+            for (uint8_t v = 0; v < Allocator::Slots; v++)
+            {
+                if (_allocator.state(v) == VoiceState::free && _voices.isActive(v))
+                {
+                    _voices.stop(v);
+                }
+            }
+        }
+
+        if (_voices.activeCount() == 0 && silent(left, right))
+        {
+            if (++_silentBlocks >= _holdBlocks)
+            {
+                _idle = true;
+                for (size_t e = 0; e < _effectCount; e++)
+                {
+                    _effects[e]->reset();
+                }
+                for (size_t b = 0; b < EffectBusCount; b++)
+                {
+                    if (_bus[b] != nullptr && !_busIdle[b])
+                    {
+                        _bus[b]->reset();
+                        _busIdle[b] = true;
+                    }
+                }
+            }
+        }
+        else
+        {
+            _silentBlocks = 0;
+        }
+        _clock.advance(BufferLength);
+        return true;
+    }
+
+    /*
+     * queues an event for the engine sample time in its timestamp, returns false when the queue is full
+     */
+    inline bool schedule(const Midi::MidiEvent &event) { return _scheduler.schedule(event); }
+
+    /*
+     * sample time of the first sample of the next block, counts on while idle
+     */
+    inline uint32_t sampleTime() const { return _scheduler.blockStart(); }
+
+    /*
+     * one block of silence without rendering, for a driver that sends its own zero block while idle
+     */
+    void skip()
+    {
+        _scheduler.skip();
+        _clock.advance(BufferLength);
+    }
+
+    /*
+     * effect shared by all channels through their send levels, returned at level into the mix
+     */
+    void setBus(EffectBus bus, StereoEffect &effect, float level = 1.0f)
+    {
+        _bus[bus] = &effect;
+        _busReturn[bus] = level;
+        _busIdle[bus] = true;
+        _busSilentBlocks[bus] = 0;
+    }
+
+    inline void setSend(uint8_t channel, EffectBus bus, float level) { _send[channel][bus] = level; }
+    inline float send(uint8_t channel, EffectBus bus) const { return _send[channel][bus]; }
+
+    bool addEffect(StereoEffect &effect)
+    {
+        if (_effectCount == MaxEffects)
+        {
+            return false;
+        }
+        _effects[_effectCount++] = &effect;
+        return true;
+    }
+
+    /*
+     * MIDI handlers, called through process()
+     */
+
+    /* transport only moves the clock, it does not wake the engine */
+    void HandleTimingClock(Midi::Messages::TimingClock &msg) { _clock.tick(_offset); }
+    void HandleStart(Midi::Messages::Start &msg) { _clock.startPlayback(); }
+    void HandleContinue(Midi::Messages::Continue &msg) { _clock.continuePlayback(); }
+    void HandleStop(Midi::Messages::Stop &msg) { _clock.stopPlayback(); }
+    void HandleSongPositionPointer(Midi::Messages::SongPositionPointer &msg) { _clock.setSongPosition(msg.beats()); }
+
+    void HandleNoteOn(Midi::Messages::NoteOn &msg)
+    {
+        wake();
+        const uint8_t channel = msg.channel();
+        const uint8_t note = msg.note();
+        if (msg.velocity() == 0)
+        {
+            noteOff(channel, note);
+            return;
+        }
+        if (_monoMode[channel])
+        {
+            apply(channel, _mono[channel].noteOn(note, msg.velocity(), msg.note().frequency()));
+            return;
+        }
+        const typename Allocator::Allocation allocation = _allocator.noteOn(channel, note);
+        if (allocation.voice == Allocator::NoVoice)
+        {
+            return;
+        }
+        if (allocation.released != Allocator::NoVoice)
+        {
+            _voices.release(allocation.released);
+        }
+        if (allocation.stolen != Allocator::NoVoice && allocation.stolen != allocation.voice &&
+            _allocator.state(allocation.stolen) == VoiceState::free)
+        {
+            // hard steal whose slot went to another note, the old sound must not keep playing
+            _voices.stop(allocation.stolen);
+        }
+        _voices.start(allocation.voice, channel, _patch[channel], msg.note().frequency(), (float)msg.velocity() / 127.0f, allocation.retrigger);
+    }
+
+    void HandleNoteOff(Midi::Messages::NoteOff &msg)
+    {
+        wake();
+        noteOff(msg.channel(), msg.note());
+    }
+
+    void HandleControlChange(Midi::Messages::ControlChange &msg)
+    {
+        wake();
+        const uint8_t channel = msg.channel();
+        switch (msg.control())
+        {
+        case 5: /* portamento time, up to 2 s */
+        {
+            const float value = (float)msg.velocity() / 127.0f;
+            _mono[channel].setGlideTime(2.0f * value * value);
+            break;
+        }
+        case 7: /* channel volume */
+            _voices.setChannelVolume(channel, (float)msg.velocity() / 127.0f);
+            break;
+        case 65: /* portamento */
+            _mono[channel].setGlide(msg.velocity() >= 64 ? _glideMode[channel] : GlideMode::off);
+            break;
+        case 91: /* reverb send */
+            _send[channel][reverbBus] = (float)msg.velocity() / 127.0f;
+            break;
+        case 93: /* chorus send */
+            _send[channel][chorusBus] = (float)msg.velocity() / 127.0f;
+            break;
+        case 94: /* delay send */
+            _send[channel][delayBus] = (float)msg.velocity() / 127.0f;
+            break;
+        case 120: /* all sound off */
+            _allocator.forEachSounding([this, channel](uint8_t v) {
+                if (_allocator.channel(v) == channel)
+                {
+                    _voices.stop(v);
+                }
+            });
+            _voices.stop(monoVoice(channel));
+            _mono[channel].reset();
+            for (uint8_t v = 0; v < Allocator::Slots; v++)
+            {
+                if (_allocator.state(v) != VoiceState::free && !_voices.isActive(v))
+                {
+                    _allocator.voiceEnded(v);
+                }
+            }
+            break;
+        case 123: /* all notes off */
+            allNotesOff(channel);
+            break;
+        case 126: /* mono on */
+            setMono(channel, true);
+            break;
+        case 127: /* poly on */
+            setMono(channel, false);
+            break;
+        default:
+            break;
+        }
+    }
+
+    void allNotesOff(uint8_t channel)
+    {
+        _allocator.notes().forEachHeld(channel, [this, channel](uint8_t note, uint8_t) {
+            const uint8_t v = _allocator.noteOff(channel, note);
+            if (v != Allocator::NoVoice)
+            {
+                _voices.release(v);
+            }
+        });
+        if (_mono[channel].note() >= 0)
+        {
+            _voices.release(monoVoice(channel));
+        }
+        _mono[channel].reset();
+    }
+
+    /*
+     * switching releases the notes of the channel
+     */
+    void setMono(uint8_t channel, bool mono)
+    {
+        if (_monoMode[channel] != mono)
+        {
+            allNotesOff(channel);
+            _monoMode[channel] = mono;
+        }
+    }
+
+    /*
+     * the glide used while portamento (CC 65) is on
+     */
+    void setGlide(uint8_t channel, GlideMode mode, float seconds)
+    {
+        _glideMode[channel] = mode;
+        _mono[channel].setGlide(mode);
+        _mono[channel].setGlideTime(seconds);
+    }
+
+    inline bool isMono(uint8_t channel) const { return _monoMode[channel]; }
+    inline Mono &mono(uint8_t channel) { return _mono[channel]; }
+    inline Patch &patch(uint8_t channel) { return _patch[channel]; }
+    /* voices the channel may hold at once */
+    inline void setVoiceQuota(uint8_t channel, uint8_t voices) { _allocator.setChannelQuota(channel, voices); }
+    inline Allocator &allocator() { return _allocator; }
+    inline Voices &voices() { return _voices; }
+    /* adaptive voice limit and CPU load telemetry */
+    inline Governor &governor() { return _governor; }
+    /* tempo from incoming MIDI clock, for Delay::syncTo() and LowFrequencyOscillator::syncTo() */
+    inline Midi::MidiClock &clock() { return _clock; }
 
-class Synth{
-    
-}
\ No newline at end of file
+    /* nothing to render: no voice sounding and no event scheduled */
+    inline bool isIdle() const { return _idle && _scheduler.pending() == 0; }
+    void setSilence(float threshold, uint32_t holdBlocks)
+    {
+        _silenceThreshold = threshold;
+        _holdBlocks = holdBlocks;
+    }
+};
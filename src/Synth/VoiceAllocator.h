@@ -0,0 +1,571 @@
+/**
+ * @file VoiceAllocator.h
+ *
+ * @brief   Voice pool with O(1) allocation and per channel stealing policies
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <cstddef>
+#include <math.h>
+#include "config.h"
+#include "ActiveNoteIndex.h"
+
+enum class VoiceState : uint8_t
+{
+    free,
+    playing,
+    releasing,
+    fading /* stolen, ramps to silence before it is free again */
+};
+
+enum class StealPolicy : uint8_t
+{
+    oldest,
+    quietest,       /* lowest envelope level reported with setLevel() */
+    lowestPriority, /* released voices first, then by note priority, oldest within a priority */
+    sameNote        /* a repeated note reuses its voice, otherwise oldest */
+};
+
+/*
+ * Doubly linked lists threaded through per voice index arrays, so moving a voice
+ * between lists never allocates. A voice is in at most one list of a VoiceLinks.
+ */
+template <size_t Slots>
+class VoiceLinks
+{
+public:
+    static const uint8_t None = 0xFF;
+
+    struct List
+    {
+        uint8_t head;
+        uint8_t tail;
+        uint8_t count;
+        List() : head(None), tail(None), count(0) {}
+    };
+
+private:
+    uint8_t _next[Slots];
+    uint8_t _prev[Slots];
+
+public:
+    inline void pushBack(List &list, uint8_t v)
+    {
+        _next[v] = None;
+        _prev[v] = list.tail;
+        if (list.tail != None)
+        {
+            _next[list.tail] = v;
+        }
+        else
+        {
+            list.head = v;
+        }
+        list.tail = v;
+        list.count++;
+    }
+
+    inline void remove(List &list, uint8_t v)
+    {
+        if (_prev[v] != None)
+        {
+            _next[_prev[v]] = _next[v];
+        }
+        else
+        {
+            list.head = _next[v];
+        }
+        if (_next[v] != None)
+        {
+            _prev[_next[v]] = _prev[v];
+        }
+        else
+        {
+            list.tail = _prev[v];
+        }
+        list.count--;
+    }
+
+    inline uint8_t popFront(List &list)
+    {
+        const uint8_t v = list.head;
+        if (v != None)
+        {
+            remove(list, v);
+        }
+        return v;
+    }
+
+    inline uint8_t next(uint8_t v) const { return _next[v]; }
+};
+
+/*
+ * Hands out voices for notes. Free voices come from a free list; when the voice limit
+ * is reached a victim is chosen by the policy of the new note's channel. The victim is
+ * not cut off: it fades out over FadeLength samples on one of FadeVoices spare slots
+ * while the new note starts on a free one. Without a spare slot the victim is reused
+ * directly (hard steal).
+ *
+ * Playing and releasing voices are kept in an age list (oldest at the head), in
+ * priority buckets (released voices in bucket 0) and in level buckets 3 dB wide, so every
+ * policy picks its victim in constant time. Quietest takes the longest waiting voice of the
+ * lowest level bucket, by the levels the renderer reports once per block; a new voice starts
+ * in the top bucket.
+ *
+ * A channel can be given a voice quota; a channel at its quota steals from its own voices
+ * (the longest released first, then the oldest) instead of taking voices from other channels.
+ * Each channel keeps its playing and its released voices in two lists of their own for that.
+ *
+ * Per block the renderer calls setLevel() for the voices it rendered, fadeGain() for
+ * fading voices and endBlock(samples); voiceEnded() when a release is over.
+ */
+template <size_t MaxVoices = MAX_POLY_VOICE, size_t FadeVoices = 4>
+class VoiceAllocator
+{
+public:
+    static const size_t Slots = MaxVoices + FadeVoices;
+    static const uint8_t NoVoice = 0xFF;
+    static const uint8_t Priorities = 8;
+    static const uint8_t ChannelPriority = 0xFF;
+    static const uint8_t LevelBuckets = 32; /* 3 dB each, the lowest holds everything below -90 dB */
+    static_assert(Slots < 255, "voice numbers are stored as bytes");
+
+    const uint32_t DefaultFadeLength = 64;
+
+    struct Allocation
+    {
+        uint8_t voice;   /* voice to start the note on */
+        uint8_t stolen;   /* voice that was taken away from another note, or NoVoice */
+        uint8_t released; /* voice of the same note struck again while held, to release, or NoVoice */
+        bool retrigger;   /* voice already played this note (sameNote) */
+    };
+
+private:
+    typedef typename VoiceLinks<Slots>::List List;
+
+    VoiceLinks<Slots> _ageLinks;
+    VoiceLinks<Slots> _poolLinks;
+    VoiceLinks<Slots> _channelLinks;
+    VoiceLinks<Slots> _levelLinks;
+    List _age;
+    List _free;
+    List _fading;
+    List _priority[Priorities];
+    /* per channel, oldest at the head; a voice moves to released when its note ends */
+    List _channelPlaying[Midi::Constants::MaxChannels];
+    List _channelReleased[Midi::Constants::MaxChannels];
+    uint8_t _priorityMask;
+    List _levelBucket[LevelBuckets];
+    uint32_t _levelMask;
+
+    ActiveNoteIndex<Slots> _notes;
+
+    VoiceState _state[Slots];
+    uint8_t _channel[Slots];
+    uint8_t _note[Slots];
+    uint8_t _voicePriority[Slots];
+    uint8_t _voiceLevelBucket[Slots];
+    uint32_t _fade[Slots];
+    float _level[Slots];
+
+    StealPolicy _policy[Midi::Constants::MaxChannels];
+    uint8_t _channelPriority[Midi::Constants::MaxChannels];
+    uint8_t _quota[Midi::Constants::MaxChannels];
+
+    size_t _limit;
+    uint32_t _fadeLength;
+    uint32_t _steals;
+
+    inline void enterBucket(uint8_t v, uint8_t priority)
+    {
+        _voicePriority[v] = priority;
+        _poolLinks.pushBack(_priority[priority], v);
+        _priorityMask |= 1u << priority;
+    }
+
+    inline void leaveBucket(uint8_t v)
+    {
+        List &bucket = _priority[_voicePriority[v]];
+        _poolLinks.remove(bucket, v);
+        if (bucket.count == 0)
+        {
+            _priorityMask &= ~(1u << _voicePriority[v]);
+        }
+    }
+
+    /*
+     * two buckets per octave of level
+     */
+    static inline uint8_t levelBucket(float level)
+    {
+        if (level <= 0.0f)
+        {
+            return 0;
+        }
+        int exponent;
+        const float mantissa = frexpf(level, &exponent);
+        const int bucket = 2 * exponent + (mantissa >= 0.70710678f ? 1 : 0) + LevelBuckets - 2;
+        return bucket < 0 ? 0 : (bucket >= LevelBuckets ? LevelBuckets - 1 : (uint8_t)bucket);
+    }
+
+    inline void enterLevel(uint8_t v, uint8_t bucket)
+    {
+        _voiceLevelBucket[v] = bucket;
+        _levelLinks.pushBack(_levelBucket[bucket], v);
+        _levelMask |= 1u << bucket;
+    }
+
+    inline void leaveLevel(uint8_t v)
+    {
+        List &bucket = _levelBucket[_voiceLevelBucket[v]];
+        _levelLinks.remove(bucket, v);
+        if (bucket.count == 0)
+        {
+            _levelMask &= ~(1u << _voiceLevelBucket[v]);
+        }
+    }
+
+    inline List &channelList(uint8_t v)
+    {
+        return _state[v] == VoiceState::releasing ? _channelReleased[_channel[v]] : _channelPlaying[_channel[v]];
+    }
+
+    /*
+     * takes a playing or releasing voice out of the age, channel, priority and level lists
+     */
+    inline void detach(uint8_t v)
+    {
+        _ageLinks.remove(_age, v);
+        _channelLinks.remove(channelList(v), v);
+        leaveBucket(v);
+        leaveLevel(v);
+        _notes.remove(_channel[v], _note[v], v);
+    }
+
+    uint8_t victim(StealPolicy policy)
+    {
+        switch (policy)
+        {
+        case StealPolicy::quietest:
+            if (_levelMask != 0)
+            {
+                return _levelBucket[__builtin_ctz(_levelMask)].head;
+            }
+            break;
+        case StealPolicy::lowestPriority:
+            if (_priorityMask != 0)
+            {
+                return _priority[__builtin_ctz(_priorityMask)].head;
+            }
+            break;
+        default:
+            break;
+        }
+        return _age.head;
+    }
+
+    /*
+     * released voice of the channel, otherwise its oldest
+     */
+    inline uint8_t channelVictim(uint8_t channel) const
+    {
+        return _channelReleased[channel].head != NoVoice ? _channelReleased[channel].head : _channelPlaying[channel].head;
+    }
+
+    /*
+     * moves the victim to the fading list, or frees it at once when no spare slot is left
+     */
+    void steal(uint8_t v)
+    {
+        detach(v);
+        _steals++;
+        if (_free.count > 0 && _fadeLength > 0)
+        {
+            _state[v] = VoiceState::fading;
+            _fade[v] = _fadeLength;
+            _poolLinks.pushBack(_fading, v);
+        }
+        else
+        {
+            _state[v] = VoiceState::free;
+            _poolLinks.pushBack(_free, v);
+        }
+    }
+
+    inline size_t sounding() const { return _age.count; }
+
+    inline void release(uint8_t v)
+    {
+        _channelLinks.remove(channelList(v), v);
+        _state[v] = VoiceState::releasing;
+        _channelLinks.pushBack(channelList(v), v);
+        leaveBucket(v);
+        enterBucket(v, 0);
+    }
+
+public:
+    VoiceAllocator() : _priorityMask(0),
+                       _levelMask(0),
+                       _limit(MaxVoices),
+                       _fadeLength(DefaultFadeLength),
+                       _steals(0)
+    {
+        for (size_t c = 0; c < Midi::Constants::MaxChannels; c++)
+        {
+            _policy[c] = StealPolicy::oldest;
+            _channelPriority[c] = Priorities / 2;
+            _quota[c] = MaxVoices;
+        }
+        reset();
+    }
+
+    void reset()
+    {
+        _age = List();
+        _free = List();
+        _fading = List();
+        for (size_t p = 0; p < Priorities; p++)
+        {
+            _priority[p] = List();
+        }
+        _priorityMask = 0;
+        for (size_t b = 0; b < LevelBuckets; b++)
+        {
+            _levelBucket[b] = List();
+        }
+        _levelMask = 0;
+        _notes.clear();
+        for (size_t c = 0; c < Midi::Constants::MaxChannels; c++)
+        {
+            _channelPlaying[c] = List();
+            _channelReleased[c] = List();
+        }
+        for (size_t v = 0; v < Slots; v++)
+        {
+            _state[v] = VoiceState::free;
+            _level[v] = 0.0f;
+            _fade[v] = 0;
+            _poolLinks.pushBack(_free, (uint8_t)v);
+        }
+    }
+
+    /*
+     * voice for a new note, priority 0..7 (higher survives longer) or the channel's priority
+     */
+    Allocation noteOn(uint8_t channel, uint8_t note, uint8_t priority = ChannelPriority)
+    {
+        Allocation result;
+        result.stolen = NoVoice;
+        result.released = NoVoice;
+        result.retrigger = false;
+        if (priority >= Priorities)
+        {
+            priority = _channelPriority[channel];
+        }
+        if (_quota[channel] == 0)
+        {
+            result.voice = NoVoice;
+            return result;
+        }
+
+        // held or still releasing
+        const uint8_t mapped = _notes.voiceOf(channel, note);
+        if (_policy[channel] == StealPolicy::sameNote && mapped != NoVoice)
+        {
+            // same voice again, starts over from where its envelope is
+            _ageLinks.remove(_age, mapped);
+            _ageLinks.pushBack(_age, mapped);
+            _channelLinks.remove(channelList(mapped), mapped);
+            leaveBucket(mapped);
+            enterBucket(mapped, priority);
+            _state[mapped] = VoiceState::playing;
+            _channelLinks.pushBack(channelList(mapped), mapped);
+            _notes.noteOn(channel, note, mapped);
+            result.voice = mapped;
+            result.retrigger = true;
+            return result;
+        }
+
+        if (_free.count == 0 && _fading.count > 0)
+        {
+            // every spare slot is still fading, cut the one closest to silence
+            voiceEnded(_fading.head);
+        }
+        if (channelCount(channel) >= _quota[channel])
+        {
+            const uint8_t v = channelVictim(channel);
+            if (v != NoVoice)
+            {
+                steal(v);
+                result.stolen = v;
+            }
+        }
+        // a quota steal already made room, the new note does not add a voice
+        if (result.stolen == NoVoice && (sounding() >= _limit || _free.count == 0))
+        {
+            const uint8_t v = victim(_policy[channel]);
+            if (v != NoVoice)
+            {
+                steal(v);
+                result.stolen = v;
+            }
+        }
+
+        const uint8_t v = _poolLinks.popFront(_free);
+        result.voice = v;
+        if (v == NoVoice)
+        {
+            return result;
+        }
+        _state[v] = VoiceState::playing;
+        _channel[v] = channel;
+        _note[v] = note;
+        _level[v] = 1.0f;
+        _ageLinks.pushBack(_age, v);
+        _channelLinks.pushBack(_channelPlaying[channel], v);
+        enterBucket(v, priority);
+        enterLevel(v, LevelBuckets - 1);
+        const uint8_t previous = _notes.noteOn(channel, note, v);
+        if (previous != NoVoice && _state[previous] == VoiceState::playing)
+        {
+            // NoteOff can only reach the new voice, the old one releases now instead of hanging
+            release(previous);
+            result.released = previous;
+        }
+        return result;
+    }
+
+    /*
+     * returns the voice to release or NoVoice, released voices become the first steal candidates
+     */
+    uint8_t noteOff(uint8_t channel, uint8_t note)
+    {
+        const uint8_t v = _notes.noteOff(channel, note);
+        if (v != NoVoice && _state[v] == VoiceState::playing)
+        {
+            release(v);
+        }
+        return v;
+    }
+
+    /*
+     * the voice's release finished
+     */
+    void voiceEnded(uint8_t v)
+    {
+        if (_state[v] == VoiceState::playing || _state[v] == VoiceState::releasing)
+        {
+            detach(v);
+        }
+        else if (_state[v] == VoiceState::fading)
+        {
+            _poolLinks.remove(_fading, v);
+        }
+        else
+        {
+            return;
+        }
+        _state[v] = VoiceState::free;
+        _poolLinks.pushBack(_free, v);
+    }
+
+    /*
+     * fades the voice chosen by the policy, used when the voice limit is lowered
+     */
+    uint8_t stealOne(StealPolicy policy = StealPolicy::quietest)
+    {
+        const uint8_t v = victim(policy);
+        if (v != NoVoice)
+        {
+            steal(v);
+        }
+        return v;
+    }
+
+    /*
+     * envelope level of a playing or releasing voice, moves it to its level bucket
+     */
+    inline void setLevel(uint8_t v, float level)
+    {
+        _level[v] = level;
+        if (_state[v] != VoiceState::playing && _state[v] != VoiceState::releasing)
+        {
+            return;
+        }
+        const uint8_t bucket = levelBucket(level);
+        if (bucket != _voiceLevelBucket[v])
+        {
+            leaveLevel(v);
+            enterLevel(v, bucket);
+        }
+    }
+
+    /*
+     * gain of a fading voice at the start of the block and after samples more
+     */
+    inline float fadeGain(uint8_t v) const { return (float)_fade[v] / (float)_fadeLength; }
+    inline float fadeGain(uint8_t v, uint32_t samples) const
+    {
+        return _fade[v] > samples ? (float)(_fade[v] - samples) / (float)_fadeLength : 0.0f;
+    }
+
+    void endBlock(uint32_t samples)
+    {
+        uint8_t v = _fading.head;
+        while (v != NoVoice)
+        {
+            const uint8_t next = _poolLinks.next(v);
+            if (_fade[v] > samples)
+            {
+                _fade[v] -= samples;
+            }
+            else
+            {
+                voiceEnded(v);
+            }
+            v = next;
+        }
+    }
+
+    /*
+     * calls f(voice) for every voice that renders: playing, releasing and fading
+     */
+    template <class F>
+    void forEachSounding(F f) const
+    {
+        for (uint8_t v = _age.head; v != NoVoice; v = _ageLinks.next(v))
+        {
+            f(v);
+        }
+        for (uint8_t v = _fading.head; v != NoVoice; v = _poolLinks.next(v))
+        {
+            f(v);
+        }
+    }
+
+    void setPolicy(uint8_t channel, StealPolicy policy) { _policy[channel] = policy; }
+    void setChannelPriority(uint8_t channel, uint8_t priority) { _channelPriority[channel] = priority < Priorities ? priority : Priorities - 1; }
+    void setFadeLength(uint32_t samples) { _fadeLength = samples; }
+    /* voices the channel may hold at once, 0 mutes it */
+    void setChannelQuota(uint8_t channel, uint8_t quota) { _quota[channel] = quota > MaxVoices ? MaxVoices : quota; }
+    inline uint8_t channelQuota(uint8_t channel) const { return _quota[channel]; }
+    inline uint8_t channelCount(uint8_t channel) const { return (uint8_t)(_channelPlaying[channel].count + _channelReleased[channel].count); }
+
+    /*
+     * voices allowed to play at once, at most MaxVoices; lowering it does not stop voices, see stealOne()
+     */
+    void setVoiceLimit(size_t limit) { _limit = limit < 1 ? 1 : (limit > MaxVoices ? MaxVoices : limit); }
+    inline size_t voiceLimit() const { return _limit; }
+    inline size_t activeCount() const { return _age.count; }
+    inline size_t fadingCount() const { return _fading.count; }
+
+    inline VoiceState state(uint8_t v) const { return _state[v]; }
+    inline uint8_t channel(uint8_t v) const { return _channel[v]; }
+    inline uint8_t note(uint8_t v) const { return _note[v]; }
+    inline float level(uint8_t v) const { return _level[v]; }
+    inline uint8_t oldest() const { return _age.head; }
+    inline const ActiveNoteIndex<Slots> &notes() const { return _notes; }
+    inline uint32_t steals() const { return _steals; }
+};
@@ -10,6 +10,7 @@
 #define MAX_POLY_VOICE  8  /* max single voices, can use multiple osc */
 #define MAX_POLY_VOICES_PER_OSC 3
 #define MAX_POLY_OSC    (MAX_POLY_VOICES_PER_OSC*MAX_POLY_VOICE) /* osc polyphony, always active reduces single voices max poly */
+#define NOTE_STACK_MAX 8 /* held notes a channel remembers, for mono note priority */
 
 
 #define SAMPLE_RATE 44100
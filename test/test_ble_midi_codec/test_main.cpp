@@ -0,0 +1,225 @@
+#include <unity.h>
+#include <stdint.h>
+#include <cstddef>
+#include <string.h>
+#include "../../lib/Midi/BleMidiCodec.h"
+
+using namespace Midi;
+
+static const float SampleRate = 44100.0f;
+
+/// @brief collects everything the decoder hands over, SysEx chunks with their flags
+struct Collector
+{
+  MidiEvent events[256];
+  size_t count;
+  uint8_t sysEx[256];
+  size_t sysExLength;
+  SysExChunk chunks[16];
+  size_t chunkCount;
+  // events seen before each chunk, to check the order of realtime bytes and SysEx
+  size_t eventsBefore[16];
+
+  Collector() : count(0), sysExLength(0), chunkCount(0) {}
+
+  void onEvents(const MidiEvent *batch, size_t length)
+  {
+    for (size_t i = 0; i < length && count < 256; i++)
+    {
+      events[count++] = batch[i];
+    }
+  }
+  void onSysEx(const SysExChunk &chunk)
+  {
+    memcpy(sysEx + sysExLength, chunk.data, chunk.length);
+    sysExLength += chunk.length;
+    eventsBefore[chunkCount] = count;
+    chunks[chunkCount++] = chunk;
+  }
+};
+
+/// @brief hands every packet straight to the decoder, the first one arrives at sample time 1000
+/// and the later ones late enough that the mapping stays on the first
+struct Loopback
+{
+  BleMidiDecoder<> decoder;
+  Collector collector;
+  size_t packets;
+  size_t longest;
+
+  Loopback() : decoder(SampleRate), packets(0), longest(0) {}
+
+  void onPacket(const uint8_t *data, size_t length)
+  {
+    TEST_ASSERT_TRUE(decoder.decode(data, length, collector, packets == 0 ? 1000 : 1000000));
+    packets++;
+    longest = length > longest ? length : longest;
+  }
+};
+
+/// @brief captures the packets without decoding them
+struct Packets
+{
+  uint8_t data[8][64];
+  size_t length[8];
+  size_t count;
+
+  Packets() : count(0) {}
+
+  void onPacket(const uint8_t *packet, size_t packetLength)
+  {
+    memcpy(data[count], packet, packetLength);
+    length[count++] = packetLength;
+  }
+};
+
+static bool sameEvent(const MidiEvent &a, const MidiEvent &b)
+{
+  return a.status == b.status && a.length == b.length &&
+         (a.length < 1 || a.data1 == b.data1) && (a.length < 2 || a.data2 == b.data2);
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_events_split_over_packets_at_the_mtu()
+{
+  static MidiEvent sent[40];
+  for (size_t i = 0; i < 40; i++)
+  {
+    // alternating channels and a controller now and then, so not everything runs
+    sent[i] = i % 5 == 4 ? MidiEvent::make(MidiMessageStatus::ControlChange, 0, 7, (uint8_t)i)
+                         : MidiEvent::make(MidiMessageStatus::NoteOn, (uint8_t)(i % 2), (uint8_t)(36 + i), 100);
+  }
+  BleMidiEncoder<> encoder;
+  Loopback loopback;
+  for (size_t i = 0; i < 40; i++)
+  {
+    // two events per millisecond
+    encoder.write(sent[i], (uint32_t)(i / 2), loopback);
+  }
+  encoder.flush(loopback);
+
+  // 23 byte MTU, 20 bytes per notification
+  TEST_ASSERT_TRUE(loopback.packets > 1);
+  TEST_ASSERT_TRUE(loopback.longest <= BleMidiEncoder<>::DefaultMtu - BleMidiEncoder<>::AttOverhead);
+  TEST_ASSERT_EQUAL(40, loopback.collector.count);
+  for (size_t i = 0; i < 40; i++)
+  {
+    TEST_ASSERT_TRUE(sameEvent(sent[i], loopback.collector.events[i]));
+    // the sender's spacing, from the first packet's arrival on
+    const uint32_t expected = 1000 + (uint32_t)((double)(i / 2) * SampleRate / 1000.0);
+    TEST_ASSERT_EQUAL(expected, loopback.collector.events[i].timestamp);
+  }
+  TEST_ASSERT_EQUAL(0, loopback.decoder.malformed());
+}
+
+void test_running_status_leaves_out_status_and_timestamp()
+{
+  BleMidiEncoder<> encoder;
+  Packets packets;
+  encoder.write(MidiEvent::make(MidiMessageStatus::NoteOn, 2, 60, 100), 5, packets);
+  encoder.write(MidiEvent::make(MidiMessageStatus::NoteOn, 2, 64, 90), 5, packets);
+  // a new time keeps the status but needs a timestamp byte
+  encoder.write(MidiEvent::make(MidiMessageStatus::NoteOn, 2, 67, 80), 6, packets);
+  encoder.flush(packets);
+  const uint8_t expected[] = {0x80, 0x85, 0x92, 60, 100, 64, 90, 0x86, 67, 80};
+  TEST_ASSERT_EQUAL(1, packets.count);
+  TEST_ASSERT_EQUAL(sizeof(expected), packets.length[0]);
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, packets.data[0], sizeof(expected));
+
+  BleMidiDecoder<> decoder(SampleRate);
+  Collector collector;
+  decoder.decode(packets.data[0], packets.length[0], collector, 0);
+  TEST_ASSERT_EQUAL(3, collector.count);
+  TEST_ASSERT_EQUAL_HEX8(0x92, collector.events[2].status);
+  TEST_ASSERT_EQUAL(67, collector.events[2].data1);
+  TEST_ASSERT_EQUAL(80, collector.events[2].data2);
+  TEST_ASSERT_EQUAL(collector.events[0].timestamp, collector.events[1].timestamp);
+  TEST_ASSERT_EQUAL(44, collector.events[2].timestamp - collector.events[0].timestamp);
+}
+
+void test_sysex_continues_over_packets()
+{
+  uint8_t payload[50];
+  for (size_t i = 0; i < sizeof(payload); i++)
+  {
+    payload[i] = (uint8_t)(i & 0x7F);
+  }
+  BleMidiEncoder<> encoder;
+  Loopback loopback;
+  // a note in front shares the first packet
+  encoder.write(MidiEvent::make(MidiMessageStatus::NoteOn, 0, 60, 100), 0, loopback);
+  encoder.writeSysEx(payload, sizeof(payload), 1, loopback);
+  encoder.write(MidiEvent::make(MidiMessageStatus::NoteOff, 0, 60, 0), 2, loopback);
+  encoder.flush(loopback);
+
+  const Collector &collector = loopback.collector;
+  TEST_ASSERT_TRUE(loopback.packets >= 3);
+  TEST_ASSERT_EQUAL(sizeof(payload), collector.sysExLength);
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(payload, collector.sysEx, sizeof(payload));
+  TEST_ASSERT_TRUE(collector.chunkCount > 1);
+  TEST_ASSERT_TRUE(collector.chunks[0].first);
+  for (size_t i = 0; i + 1 < collector.chunkCount; i++)
+  {
+    TEST_ASSERT_FALSE(collector.chunks[i].last);
+  }
+  TEST_ASSERT_TRUE(collector.chunks[collector.chunkCount - 1].last);
+  TEST_ASSERT_FALSE(collector.chunks[collector.chunkCount - 1].aborted);
+  // the note before and the note after, in order around the dump
+  TEST_ASSERT_EQUAL(2, collector.count);
+  TEST_ASSERT_EQUAL(1, collector.eventsBefore[0]);
+  TEST_ASSERT_EQUAL_HEX8(0x80, collector.events[1].status);
+  TEST_ASSERT_EQUAL(0, loopback.decoder.malformed());
+}
+
+void test_realtime_inside_sysex()
+{
+  // F0 01 02, clock, 03 04 F7
+  const uint8_t packet[] = {0x80, 0x81, 0xF0, 0x01, 0x02, 0x82, 0xF8, 0x03, 0x04, 0x83, 0xF7};
+  BleMidiDecoder<> decoder(SampleRate);
+  Collector collector;
+  TEST_ASSERT_TRUE(decoder.decode(packet, sizeof(packet), collector, 0));
+
+  const uint8_t payload[] = {0x01, 0x02, 0x03, 0x04};
+  TEST_ASSERT_EQUAL(sizeof(payload), collector.sysExLength);
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(payload, collector.sysEx, sizeof(payload));
+  TEST_ASSERT_EQUAL(2, collector.chunkCount);
+  TEST_ASSERT_TRUE(collector.chunks[0].first);
+  TEST_ASSERT_FALSE(collector.chunks[0].last);
+  TEST_ASSERT_TRUE(collector.chunks[1].last);
+  TEST_ASSERT_FALSE(collector.chunks[1].aborted);
+  // the clock comes between the two halves
+  TEST_ASSERT_EQUAL(1, collector.count);
+  TEST_ASSERT_EQUAL_HEX8(0xF8, collector.events[0].status);
+  TEST_ASSERT_EQUAL(0, collector.eventsBefore[0]);
+  TEST_ASSERT_EQUAL(1, collector.eventsBefore[1]);
+}
+
+void test_sysex_cut_off_by_a_status_is_aborted()
+{
+  const uint8_t packet[] = {0x80, 0x81, 0xF0, 0x01, 0x02, 0x82, 0x90, 0x40, 0x7F};
+  BleMidiDecoder<> decoder(SampleRate);
+  Collector collector;
+  TEST_ASSERT_TRUE(decoder.decode(packet, sizeof(packet), collector, 0));
+  TEST_ASSERT_EQUAL(1, collector.chunkCount);
+  TEST_ASSERT_TRUE(collector.chunks[0].last);
+  TEST_ASSERT_TRUE(collector.chunks[0].aborted);
+  TEST_ASSERT_EQUAL(1, collector.count);
+  TEST_ASSERT_EQUAL_HEX8(0x90, collector.events[0].status);
+
+  // a collected message that was cut off is not complete
+  SysExArena<64> arena;
+  TEST_ASSERT_FALSE(arena.append(collector.chunks[0]));
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_events_split_over_packets_at_the_mtu);
+  RUN_TEST(test_running_status_leaves_out_status_and_timestamp);
+  RUN_TEST(test_sysex_continues_over_packets);
+  RUN_TEST(test_realtime_inside_sysex);
+  RUN_TEST(test_sysex_cut_off_by_a_status_is_aborted);
+  return UNITY_END();
+}
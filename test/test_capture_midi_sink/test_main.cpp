@@ -0,0 +1,148 @@
+#include <unity.h>
+#include <stdint.h>
+#include <cstddef>
+#include <stdio.h>
+#include "../../lib/Midi/CaptureMidiSink.h"
+
+using namespace Midi;
+
+static const char *Path = "test_capture.mid";
+
+static uint32_t now;
+static uint32_t fakeMicros() { return now; }
+
+/// @brief the track events of a capture file, delta ticks and status bytes
+struct TrackEvents
+{
+  uint32_t deltas[64];
+  uint8_t status[64];
+  size_t count;
+  bool ended;
+};
+
+static uint32_t readVariable(const uint8_t *&p)
+{
+  uint32_t value = 0;
+  uint8_t b;
+  do
+  {
+    b = *p++;
+    value = (value << 7) | (b & 0x7F);
+  } while (b & 0x80);
+  return value;
+}
+
+/// @brief reads the file back, skipping the tempo event in front and stopping at end of track
+static void readBack(TrackEvents &track)
+{
+  static uint8_t bytes[1024];
+  FILE *file = fopen(Path, "rb");
+  TEST_ASSERT_NOT_NULL(file);
+  const size_t length = fread(bytes, 1, sizeof(bytes), file);
+  fclose(file);
+  TEST_ASSERT_TRUE(length > 14 + 8 + 7);
+  const uint32_t trackLength = ((uint32_t)bytes[18] << 24) | ((uint32_t)bytes[19] << 16) | ((uint32_t)bytes[20] << 8) | bytes[21];
+  TEST_ASSERT_EQUAL(length - 22, trackLength);
+
+  const uint8_t *p = bytes + 22 + 7;
+  track.count = 0;
+  track.ended = false;
+  while (p < bytes + length)
+  {
+    const uint32_t delta = readVariable(p);
+    if (p[0] == 0xFF && p[1] == 0x2F)
+    {
+      track.ended = true;
+      break;
+    }
+    track.deltas[track.count] = delta;
+    track.status[track.count++] = p[0];
+    p += (p[0] & 0xE0) == 0xC0 ? 2 : 3;
+  }
+}
+
+void setUp() { now = 0; }
+void tearDown() { remove(Path); }
+
+void test_sink_stamps_with_its_clock_while_connected()
+{
+  CaptureMidiSink<16> sink(fakeMicros);
+  now = 100;
+  sink.send(MidiEvent::make(MidiMessageStatus::NoteOn, 0, 60, 100));
+  sink.start();
+  now = 250;
+  sink.send(MidiEvent::make(MidiMessageStatus::NoteOn, 0, 62, 100, 12345));
+  sink.stop();
+  sink.send(MidiEvent::make(MidiMessageStatus::NoteOff, 0, 62, 0));
+
+  MidiEvent events[4];
+  TEST_ASSERT_EQUAL(1, sink.drain(events, 4));
+  TEST_ASSERT_EQUAL(62, events[0].data1);
+  TEST_ASSERT_EQUAL(250, events[0].timestamp);
+  TEST_ASSERT_EQUAL(0, sink.overflows());
+}
+
+void test_smf_deltas_round_down_without_drift()
+{
+  // 150 us apart: 1.5 ticks each, written as 1, 2, 1, 2, ...
+  static MidiEvent events[40];
+  for (size_t i = 0; i < 40; i++)
+  {
+    events[i] = MidiEvent::make(MidiMessageStatus::ControlChange, 0, 1, (uint8_t)i, 1000 + 150 * (uint32_t)i);
+  }
+  SmfCaptureWriter writer;
+  TEST_ASSERT_TRUE(writer.open(Path));
+  // in two parts, the remainder carries over between calls
+  writer.write(events, 25);
+  writer.write(events + 25, 15);
+  writer.close();
+
+  TrackEvents track;
+  readBack(track);
+  TEST_ASSERT_TRUE(track.ended);
+  TEST_ASSERT_EQUAL(40, track.count);
+  uint32_t total = 0;
+  for (size_t i = 0; i < 40; i++)
+  {
+    TEST_ASSERT_EQUAL(i == 0 ? 0 : (i % 2 == 1 ? 1 : 2), track.deltas[i]);
+    total += track.deltas[i];
+  }
+  // 39 * 150 us is 58.5 ticks
+  TEST_ASSERT_EQUAL(58, total);
+}
+
+void test_smf_writes_channel_messages_only()
+{
+  MidiEvent events[6] = {
+      MidiEvent::make(MidiMessageStatus::NoteOn, 1, 60, 100, 0),
+      MidiEvent::make(0xF8, 0, 0, 0, 1000),
+      MidiEvent::make(0xFE, 0, 0, 0, 2000),
+      MidiEvent::make(MidiMessageStatus::ProgramChange, 1, 5, 0, 3000),
+      MidiEvent::make(0xF2, 0x10, 0x00, 2, 4000),
+      MidiEvent::make(MidiMessageStatus::NoteOff, 1, 60, 0, 5000)};
+  SmfCaptureWriter writer;
+  TEST_ASSERT_TRUE(writer.open(Path));
+  writer.write(events, 6);
+  writer.close();
+
+  TrackEvents track;
+  readBack(track);
+  TEST_ASSERT_TRUE(track.ended);
+  TEST_ASSERT_EQUAL(3, track.count);
+  TEST_ASSERT_EQUAL_HEX8(0x91, track.status[0]);
+  TEST_ASSERT_EQUAL_HEX8(0xC1, track.status[1]);
+  TEST_ASSERT_EQUAL_HEX8(0x81, track.status[2]);
+  // the time of the skipped events still counts
+  TEST_ASSERT_EQUAL(0, track.deltas[0]);
+  TEST_ASSERT_EQUAL(30, track.deltas[1]);
+  TEST_ASSERT_EQUAL(20, track.deltas[2]);
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_sink_stamps_with_its_clock_while_connected);
+  RUN_TEST(test_smf_deltas_round_down_without_drift);
+  RUN_TEST(test_smf_writes_channel_messages_only);
+  return UNITY_END();
+}
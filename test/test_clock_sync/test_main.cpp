@@ -0,0 +1,214 @@
+#include <unity.h>
+#include <stdint.h>
+#include <cstddef>
+#include <math.h>
+#include "../../lib/Midi/MidiClock.h"
+#include "../../lib/Synthesis/Delay.h"
+#include "../../lib/Synthesis/LowFrequencyOscillator.h"
+
+using namespace Synthesis;
+
+static const float SampleRate = 44100.0f;
+static const size_t BlockLength = 48;
+
+/*
+ * MIDI clock ticks at a fixed tempo, delivered at their sample inside each block
+ */
+class TickSource
+{
+private:
+    Midi::MidiClock &_clock;
+    float _nextTick = 0.0f;
+    float _position = 0.0f;
+
+public:
+    TickSource(Midi::MidiClock &clock) : _clock(clock) {}
+
+    /* feeds the ticks of the next block, the caller processes the block and then advances the clock */
+    void block(float bpm)
+    {
+        const float period = SampleRate * 60.0f / (bpm * Midi::MidiClock::TicksPerBeat);
+        while (_nextTick < _position + (float)BlockLength)
+        {
+            _clock.tick((uint32_t)(_nextTick - _position));
+            _nextTick += period;
+        }
+        _position += (float)BlockLength;
+    }
+};
+
+static StaticSampleBuffer<BlockLength> input;
+static StaticSampleBuffer<BlockLength> output;
+
+static void fill(SampleBuffer &buffer, float value)
+{
+    for (size_t n = 0; n < buffer.length(); n++)
+    {
+        buffer[n] = value;
+    }
+}
+
+/*
+ * sends one impulse through the delay and returns the sample distance to its first echo
+ */
+template <size_t Length>
+static size_t echoDistance(Delay<Length> &delay, Midi::MidiClock &clock, TickSource &ticks, float bpm)
+{
+    const size_t limit = Length + BlockLength;
+    for (size_t done = 0; done < limit; done += BlockLength)
+    {
+        ticks.block(bpm);
+        fill(input, 0.0f);
+        if (done == 0)
+        {
+            input[0] = 1.0f;
+        }
+        fill(output, 0.0f);
+        delay.process(input, output);
+        clock.advance(BlockLength);
+        for (size_t n = 0; n < BlockLength; n++)
+        {
+            if (output[n] > 0.25f)
+            {
+                return done + n;
+            }
+        }
+    }
+    return 0;
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_synced_delay_follows_the_tempo()
+{
+    static Delay<12000> delay;
+    Midi::MidiClock clock(SampleRate);
+    TickSource ticks(clock);
+    delay.setOutputLevel(1.0f);
+    clock.startPlayback();
+    // one eighth note
+    delay.syncTo(clock, 0.5f);
+
+    // two seconds to lock and glide
+    for (size_t b = 0; b < 2 * 44100 / BlockLength; b++)
+    {
+        ticks.block(120.0f);
+        fill(input, 0.0f);
+        fill(output, 0.0f);
+        delay.process(input, output);
+        clock.advance(BlockLength);
+    }
+    TEST_ASSERT_TRUE(clock.isLocked());
+    TEST_ASSERT_TRUE(fabsf(clock.bpm() - 120.0f) < 0.5f);
+    // 11025 samples at 120 BPM
+    size_t distance = echoDistance(delay, clock, ticks, 120.0f);
+    TEST_ASSERT_TRUE(distance > 11025 - 8 && distance < 11025 + 8);
+
+    // faster tempo, shorter echo once the loop settled again
+    for (size_t b = 0; b < 4 * 44100 / BlockLength; b++)
+    {
+        ticks.block(150.0f);
+        fill(input, 0.0f);
+        fill(output, 0.0f);
+        delay.process(input, output);
+        clock.advance(BlockLength);
+    }
+    distance = echoDistance(delay, clock, ticks, 150.0f);
+    TEST_ASSERT_TRUE(distance > 8820 - 8 && distance < 8820 + 8);
+}
+
+void test_synced_delay_is_limited_to_its_buffer()
+{
+    static Delay<4800> delay;
+    Midi::MidiClock clock(SampleRate);
+    TickSource ticks(clock);
+    delay.setOutputLevel(1.0f);
+    clock.startPlayback();
+    // a whole note at 120 BPM does not fit
+    delay.syncTo(clock, 4.0f);
+    for (size_t b = 0; b < 2 * 44100 / BlockLength; b++)
+    {
+        ticks.block(120.0f);
+        fill(input, 0.0f);
+        fill(output, 0.0f);
+        delay.process(input, output);
+        clock.advance(BlockLength);
+    }
+    TEST_ASSERT_TRUE(delay.getDelayLength() <= 4800);
+    TEST_ASSERT_TRUE(delay.getDelayLength() > 4800 - 8);
+}
+
+void test_synced_lfo_completes_one_cycle_per_beat_in_phase()
+{
+    LowFrequencyOscillator<BlockLength> lfo(SampleRate);
+    Midi::MidiClock clock(SampleRate);
+    TickSource ticks(clock);
+    clock.startPlayback();
+    lfo.syncTo(clock, 1.0f);
+
+    float last = 0.0f;
+    size_t crossings = 0;
+    float worstBeatStart = 0.0f;
+    // eight seconds, sixteen beats at 120 BPM
+    const size_t blocks = 8 * 44100 / BlockLength;
+    for (size_t b = 0; b < blocks; b++)
+    {
+        ticks.block(120.0f);
+        fill(input, 1.0f);
+        lfo.process(input, output);
+        const size_t position = b * BlockLength;
+        for (size_t n = 0; n < BlockLength; n++)
+        {
+            if (last < 0.0f && output[n] >= 0.0f)
+            {
+                crossings++;
+            }
+            last = output[n];
+            // beats fall on every 22050th sample, the sine starts its cycle there
+            if (position > 44100 && (position + n) % 22050 == 0)
+            {
+                worstBeatStart = fmaxf(worstBeatStart, fabsf(output[n]));
+            }
+        }
+        clock.advance(BlockLength);
+    }
+    TEST_ASSERT_TRUE(crossings >= 15 && crossings <= 16);
+    // within about 1 % of a cycle
+    TEST_ASSERT_TRUE(worstBeatStart < 0.07f);
+}
+
+void test_lfo_free_runs_while_the_clock_is_stopped()
+{
+    LowFrequencyOscillator<BlockLength> lfo(SampleRate);
+    Midi::MidiClock clock(SampleRate);
+    lfo.syncTo(clock, 1.0f);
+
+    // 10 Hz from the input signal, not the clock
+    float last = 0.0f;
+    size_t crossings = 0;
+    for (size_t b = 0; b < 44100 / BlockLength; b++)
+    {
+        fill(input, 10.0f);
+        lfo.process(input, output);
+        for (size_t n = 0; n < BlockLength; n++)
+        {
+            if (last < 0.0f && output[n] >= 0.0f)
+            {
+                crossings++;
+            }
+            last = output[n];
+        }
+    }
+    TEST_ASSERT_TRUE(crossings >= 9 && crossings <= 10);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_synced_delay_follows_the_tempo);
+    RUN_TEST(test_synced_delay_is_limited_to_its_buffer);
+    RUN_TEST(test_synced_lfo_completes_one_cycle_per_beat_in_phase);
+    RUN_TEST(test_lfo_free_runs_while_the_clock_is_stopped);
+    return UNITY_END();
+}
@@ -0,0 +1,129 @@
+#include <unity.h>
+#include <stdint.h>
+#include <cstddef>
+#include "../../lib/Midi/ControllerCoalescer.h"
+
+using namespace Midi;
+
+static MidiEvent cc(uint8_t channel, uint8_t controller, uint8_t value)
+{
+  return MidiEvent::make(MidiMessageStatus::ControlChange, channel, controller, value);
+}
+
+static MidiEvent note(uint8_t channel, uint8_t key, uint8_t velocity)
+{
+  return MidiEvent::make(MidiMessageStatus::NoteOn, channel, key, velocity);
+}
+
+static bool same(const MidiEvent &a, const MidiEvent &b)
+{
+  return a.status == b.status && a.data1 == b.data1 && a.data2 == b.data2;
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_latest_value_per_key_survives_in_order()
+{
+  MidiEvent events[] = {
+      cc(0, 7, 10),
+      cc(0, 1, 20),
+      cc(1, 7, 30),
+      MidiEvent::make(MidiMessageStatus::PitchBendChange, 0, 0, 60),
+      cc(0, 7, 11),
+      MidiEvent::make(MidiMessageStatus::PolyphonicKeyPressure, 0, 60, 5),
+      MidiEvent::make(MidiMessageStatus::PolyphonicKeyPressure, 0, 61, 6),
+      MidiEvent::make(MidiMessageStatus::PitchBendChange, 0, 0, 70),
+      MidiEvent::make(MidiMessageStatus::PolyphonicKeyPressure, 0, 60, 7),
+      cc(0, 7, 12)};
+  const MidiEvent expected[] = {
+      cc(0, 1, 20),
+      cc(1, 7, 30),
+      MidiEvent::make(MidiMessageStatus::PolyphonicKeyPressure, 0, 61, 6),
+      MidiEvent::make(MidiMessageStatus::PitchBendChange, 0, 0, 70),
+      MidiEvent::make(MidiMessageStatus::PolyphonicKeyPressure, 0, 60, 7),
+      cc(0, 7, 12)};
+  ControllerCoalescer coalescer;
+  const size_t kept = coalescer.coalesce(events, 10);
+  TEST_ASSERT_EQUAL(6, kept);
+  for (size_t i = 0; i < kept; i++)
+  {
+    TEST_ASSERT_TRUE(same(expected[i], events[i]));
+  }
+  TEST_ASSERT_EQUAL(4, coalescer.dropped());
+}
+
+void test_notes_are_barriers_on_their_channel_only()
+{
+  // sustain down, note off, sustain up: the release has to stay behind the note off
+  MidiEvent events[] = {
+      cc(0, 64, 127),
+      cc(1, 64, 127),
+      note(0, 60, 0),
+      cc(0, 64, 0),
+      cc(1, 64, 0)};
+  ControllerCoalescer coalescer;
+  const size_t kept = coalescer.coalesce(events, 5);
+  TEST_ASSERT_EQUAL(4, kept);
+  TEST_ASSERT_TRUE(same(cc(0, 64, 127), events[0]));
+  TEST_ASSERT_TRUE(same(note(0, 60, 0), events[1]));
+  TEST_ASSERT_TRUE(same(cc(0, 64, 0), events[2]));
+  // channel 1 saw no barrier, only its last pedal value is left
+  TEST_ASSERT_TRUE(same(cc(1, 64, 0), events[3]));
+}
+
+void test_ordered_controllers_and_program_changes_are_kept()
+{
+  // an RPN selection and data entry in between two volume values, twice, then a program change
+  MidiEvent events[] = {
+      cc(2, 7, 1),
+      cc(2, 101, 0),
+      cc(2, 100, 0),
+      cc(2, 6, 2),
+      cc(2, 101, 0),
+      cc(2, 100, 0),
+      cc(2, 6, 12),
+      cc(2, 7, 2),
+      MidiEvent::make(MidiMessageStatus::ProgramChange, 2, 4, 0),
+      cc(2, 123, 0),
+      cc(2, 123, 0)};
+  ControllerCoalescer coalescer;
+  TEST_ASSERT_EQUAL(11, coalescer.coalesce(events, 11));
+  TEST_ASSERT_EQUAL(0, coalescer.dropped());
+}
+
+void test_realtime_and_system_events_pass_and_dropped_counts_up()
+{
+  ControllerCoalescer coalescer;
+  MidiEvent events[] = {
+      cc(0, 74, 1),
+      MidiEvent::make(0xF8, 0, 0, 0, 0),
+      cc(0, 74, 2),
+      MidiEvent::make(0xF8, 0, 0, 0, 0),
+      cc(0, 74, 3)};
+  // realtime bytes are no barrier, the filter value collapses around them
+  TEST_ASSERT_EQUAL(3, coalescer.coalesce(events, 5));
+  TEST_ASSERT_EQUAL_HEX8(0xF8, events[0].status);
+  TEST_ASSERT_EQUAL_HEX8(0xF8, events[1].status);
+  TEST_ASSERT_TRUE(same(cc(0, 74, 3), events[2]));
+  TEST_ASSERT_EQUAL(2, coalescer.dropped());
+
+  // a single event is left alone, and a new batch does not remember the last one
+  TEST_ASSERT_EQUAL(1, coalescer.coalesce(events + 2, 1));
+  MidiEvent again[] = {cc(0, 74, 4), cc(0, 74, 5)};
+  TEST_ASSERT_EQUAL(1, coalescer.coalesce(again, 2));
+  TEST_ASSERT_EQUAL(5, again[0].data2);
+
+  TEST_ASSERT_EQUAL(3, coalescer.takeDropped());
+  TEST_ASSERT_EQUAL(0, coalescer.dropped());
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_latest_value_per_key_survives_in_order);
+  RUN_TEST(test_notes_are_barriers_on_their_channel_only);
+  RUN_TEST(test_ordered_controllers_and_program_changes_are_kept);
+  RUN_TEST(test_realtime_and_system_events_pass_and_dropped_counts_up);
+  return UNITY_END();
+}
@@ -0,0 +1,208 @@
+#include <unity.h>
+#include <stdint.h>
+#include <cstddef>
+#include <math.h>
+#include "../../lib/Synthesis/Reverb.h"
+
+using namespace Synthesis;
+
+static const size_t BlockLength = 48;
+
+static StaticSampleBuffer<BlockLength> input;
+static StaticSampleBuffer<BlockLength> output;
+
+/*
+ * sample by sample Schroeder all-pass to compare the block loops against
+ */
+class ReferenceAllPass
+{
+private:
+    float _buffer[1024];
+    uint32_t _p = 0;
+    uint32_t _lim;
+    float _g;
+
+public:
+    ReferenceAllPass(float g, uint32_t lim) : _lim(lim), _g(g)
+    {
+        for (size_t i = 0; i < 1024; i++)
+        {
+            _buffer[i] = 0.0f;
+        }
+    }
+    float step(float x)
+    {
+        const float readback = _buffer[_p] - _g * x;
+        _buffer[_p] = readback * _g + x;
+        _p = _p + 1 >= _lim ? 0 : _p + 1;
+        return readback;
+    }
+};
+
+void setUp() {}
+void tearDown() {}
+
+void test_all_pass_impulse_response()
+{
+    static AllPass<1024> allPass(0, 0.7f, 100);
+    float energy = 0.0f;
+    for (size_t b = 0; b < 200; b++)
+    {
+        input.clear();
+        input[0] = b == 0 ? 1.0f : 0.0f;
+        allPass.process(input, output);
+        for (size_t n = 0; n < BlockLength; n++)
+        {
+            const size_t index = b * BlockLength + n;
+            if (index == 0)
+            {
+                TEST_ASSERT_TRUE(fabsf(output[n] + 0.7f) < 1e-6f);
+            }
+            else if (index == 100)
+            {
+                TEST_ASSERT_TRUE(fabsf(output[n] - (1.0f - 0.7f * 0.7f)) < 1e-6f);
+            }
+            else if (index < 100)
+            {
+                TEST_ASSERT_TRUE(output[n] == 0.0f);
+            }
+            energy += output[n] * output[n];
+        }
+    }
+    // an all-pass keeps the energy of the impulse
+    TEST_ASSERT_TRUE(fabsf(energy - 1.0f) < 1e-3f);
+}
+
+void test_block_loops_match_the_sample_loop()
+{
+    // loop lengths that end inside a block, on a block edge and inside the first block
+    const uint32_t limits[] = {100, 96, 30};
+    for (size_t i = 0; i < 3; i++)
+    {
+        static AllPass<1024> allPass;
+        allPass = AllPass<1024>(0, 0.5f, limits[i]);
+        allPass.reset();
+        ReferenceAllPass reference(0.5f, limits[i]);
+        float worst = 0.0f;
+        for (size_t b = 0; b < 20; b++)
+        {
+            for (size_t n = 0; n < BlockLength; n++)
+            {
+                input[n] = sinf(0.37f * (float)(b * BlockLength + n));
+            }
+            allPass.process(input, output);
+            for (size_t n = 0; n < BlockLength; n++)
+            {
+                worst = fmaxf(worst, fabsf(output[n] - reference.step(input[n])));
+            }
+        }
+        TEST_ASSERT_TRUE(worst < 1e-6f);
+    }
+}
+
+void test_length_is_limited_to_the_delay_line()
+{
+    static AllPass<64> allPass(0, 0.5f, 1000);
+    input.clear();
+    input[0] = 1.0f;
+    allPass.process(input, output);
+    input[0] = 0.0f;
+    allPass.process(input, output);
+    // the echo comes back after 64 samples, not 1000
+    TEST_ASSERT_TRUE(fabsf(output[64 - BlockLength] - 0.75f) < 1e-6f);
+}
+
+void test_comb_adds_decaying_echoes()
+{
+    static Comb<1024> comb(0, 0.5f, 40);
+    float echoes[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    // 144 samples, the impulse and three echoes
+    for (size_t b = 0; b < 3; b++)
+    {
+        input.clear();
+        input[0] = b == 0 ? 1.0f : 0.0f;
+        // the comb adds to what is already in the output
+        for (size_t n = 0; n < BlockLength; n++)
+        {
+            output[n] = 1.0f;
+        }
+        comb.process(input, output);
+        for (size_t n = 0; n < BlockLength; n++)
+        {
+            const size_t index = b * BlockLength + n;
+            if (index % 40 == 0)
+            {
+                echoes[index / 40] = output[n] - 1.0f;
+            }
+            else
+            {
+                TEST_ASSERT_TRUE(output[n] == 1.0f);
+            }
+        }
+    }
+    TEST_ASSERT_TRUE(echoes[0] == 0.0f);
+    TEST_ASSERT_TRUE(echoes[1] == 1.0f);
+    TEST_ASSERT_TRUE(echoes[2] == 0.5f);
+    TEST_ASSERT_TRUE(echoes[3] == 0.25f);
+}
+
+void test_reverb_tail_decays_and_resets()
+{
+    static Reverb<BlockLength> reverb(1.0f, 1.0f);
+    static StaticSampleBuffer<BlockLength> dry;
+    float tail = 0.0f;
+    float late = 0.0f;
+    // three seconds after one impulse
+    for (size_t b = 0; b < 3 * 44100 / BlockLength; b++)
+    {
+        dry.clear();
+        dry[0] = b == 0 ? 1.0f : 0.0f;
+        reverb.process(dry, output);
+        for (size_t n = 0; n < BlockLength; n++)
+        {
+            if (b > 0 && b < 44100 / BlockLength)
+            {
+                tail = fmaxf(tail, fabsf(output[n]));
+            }
+            if (b > 2 * 44100 / BlockLength)
+            {
+                late = fmaxf(late, fabsf(output[n]));
+            }
+        }
+    }
+    TEST_ASSERT_TRUE(tail > 0.01f);
+    TEST_ASSERT_TRUE(late < 1e-3f);
+
+    // without reverb level only the dry signal passes
+    dry.clear();
+    dry[0] = 1.0f;
+    reverb.setLevel(0.0f);
+    reverb.process(dry, output);
+    TEST_ASSERT_TRUE(output[0] == 1.0f);
+
+    // a reset silences the tail of that impulse
+    reverb.setLevel(1.0f);
+    reverb.reset();
+    dry.clear();
+    float after = 0.0f;
+    for (size_t b = 0; b < 44100 / BlockLength; b++)
+    {
+        reverb.process(dry, output);
+        for (size_t n = 0; n < BlockLength; n++)
+        {
+            after = fmaxf(after, fabsf(output[n]));
+        }
+    }
+    TEST_ASSERT_TRUE(after == 0.0f);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_all_pass_impulse_response);
+    RUN_TEST(test_block_loops_match_the_sample_loop);
+    RUN_TEST(test_length_is_limited_to_the_delay_line);
+    RUN_TEST(test_comb_adds_decaying_echoes);
+    RUN_TEST(test_reverb_tail_decays_and_resets);
+    return UNITY_END();
+}
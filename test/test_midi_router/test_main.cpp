@@ -0,0 +1,141 @@
+#include <unity.h>
+#include <stdint.h>
+#include <cstddef>
+#include "../../lib/Midi/MidiRouter.h"
+
+using namespace Midi;
+
+/// @brief remembers what reached it
+class RecordingSink : public MidiSink
+{
+public:
+  MidiEvent events[64];
+  size_t count = 0;
+  size_t sysExChunks = 0;
+
+  virtual void send(const MidiEvent &event) override
+  {
+    if (count < 64)
+    {
+      events[count++] = event;
+    }
+  }
+  virtual void sendSysEx(const SysExChunk &chunk) override { sysExChunks++; }
+  virtual void start() override {}
+  virtual void stop() override {}
+  virtual bool isConnected() override { return true; }
+};
+
+static MidiEvent note(uint8_t channel, uint8_t key)
+{
+  return MidiEvent::make(MidiMessageStatus::NoteOn, channel, key, 100);
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_split_sends_each_note_to_its_range()
+{
+  RecordingSink lower, upper;
+  MidiRouter<> router;
+  const int left = router.addOutput(lower);
+  const int right = router.addOutput(upper);
+  router.setNoteRange(left, 0, 59);
+  router.setNoteRange(right, 60, 127);
+
+  router.send(note(0, 59));
+  router.send(note(0, 60));
+  router.send(MidiEvent::make(MidiMessageStatus::NoteOff, 0, 59, 0));
+  router.send(MidiEvent::make(MidiMessageStatus::PolyphonicKeyPressure, 0, 72, 10));
+  // controllers are not notes and reach both sides
+  router.send(MidiEvent::make(MidiMessageStatus::ControlChange, 0, 64, 127));
+
+  TEST_ASSERT_EQUAL(3, lower.count);
+  TEST_ASSERT_EQUAL(59, lower.events[0].data1);
+  TEST_ASSERT_EQUAL_HEX8(0x80, lower.events[1].status);
+  TEST_ASSERT_EQUAL_HEX8(0xB0, lower.events[2].status);
+  TEST_ASSERT_EQUAL(3, upper.count);
+  TEST_ASSERT_EQUAL(60, upper.events[0].data1);
+  TEST_ASSERT_EQUAL_HEX8(0xA0, upper.events[1].status);
+  TEST_ASSERT_EQUAL_HEX8(0xB0, upper.events[2].status);
+}
+
+void test_transpose_applies_after_the_range_and_drops_notes_out_of_midi()
+{
+  RecordingSink sink;
+  MidiRouter<> router;
+  const int output = router.addOutput(sink);
+  router.setNoteRange(output, 0, 100);
+  router.setTranspose(output, 24);
+
+  router.send(note(0, 60));
+  // the range checks the played note: 103 is outside it, 100 passes as 124
+  router.send(note(0, 100));
+  router.send(note(0, 103));
+  // 134 is past the MIDI range
+  router.setNoteRange(output, 0, 127);
+  router.send(note(0, 110));
+  TEST_ASSERT_EQUAL(2, sink.count);
+  TEST_ASSERT_EQUAL(84, sink.events[0].data1);
+  TEST_ASSERT_EQUAL(124, sink.events[1].data1);
+
+  router.setTranspose(output, -12);
+  router.send(note(0, 5));
+  router.send(note(0, 12));
+  TEST_ASSERT_EQUAL(3, sink.count);
+  TEST_ASSERT_EQUAL(0, sink.events[2].data1);
+}
+
+void test_remap_moves_channel_messages_only()
+{
+  RecordingSink sink;
+  MidiRouter<> router;
+  const int output = router.addOutput(sink);
+  router.setChannelRemap(output, 9);
+
+  router.send(note(3, 60));
+  router.send(MidiEvent::make(MidiMessageStatus::ProgramChange, 5, 7, 0));
+  router.send(MidiEvent::make(0xF8, 0, 0, 0));
+  TEST_ASSERT_EQUAL(3, sink.count);
+  TEST_ASSERT_EQUAL_HEX8(0x99, sink.events[0].status);
+  TEST_ASSERT_EQUAL(60, sink.events[0].data1);
+  TEST_ASSERT_EQUAL_HEX8(0xC9, sink.events[1].status);
+  TEST_ASSERT_EQUAL_HEX8(0xF8, sink.events[2].status);
+
+  // back to the original channel
+  router.setChannelRemap(output, -1);
+  router.send(note(3, 61));
+  TEST_ASSERT_EQUAL_HEX8(0x93, sink.events[3].status);
+}
+
+void test_channel_and_type_masks_select_outputs()
+{
+  RecordingSink drums, clock;
+  MidiRouter<> router;
+  router.addOutput(drums, 1u << 9, MidiRouter<>::typeBit(MidiMessageStatus::NoteOn) | MidiRouter<>::typeBit(MidiMessageStatus::NoteOff));
+  router.addOutput(clock, MidiRouter<>::AllChannels, MidiRouter<>::statusBit(0xF8) | MidiRouter<>::statusBit(0xF0));
+
+  router.send(note(9, 36));
+  router.send(note(0, 36));
+  router.send(MidiEvent::make(MidiMessageStatus::ControlChange, 9, 7, 100));
+  router.send(MidiEvent::make(0xF8, 0, 0, 0));
+  SysExChunk chunk = {nullptr, 0, 0, true, true, false};
+  router.sendSysEx(chunk);
+
+  TEST_ASSERT_EQUAL(1, drums.count);
+  TEST_ASSERT_EQUAL_HEX8(0x99, drums.events[0].status);
+  TEST_ASSERT_EQUAL(0, drums.sysExChunks);
+  TEST_ASSERT_EQUAL(1, clock.count);
+  TEST_ASSERT_EQUAL_HEX8(0xF8, clock.events[0].status);
+  TEST_ASSERT_EQUAL(1, clock.sysExChunks);
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_split_sends_each_note_to_its_range);
+  RUN_TEST(test_transpose_applies_after_the_range_and_drops_notes_out_of_midi);
+  RUN_TEST(test_remap_moves_channel_messages_only);
+  RUN_TEST(test_channel_and_type_masks_select_outputs);
+  return UNITY_END();
+}
@@ -0,0 +1,135 @@
+#include <unity.h>
+#include <stdint.h>
+#include <cstddef>
+#include <string.h>
+#include "../../lib/Midi/MidiStreamEncoder.h"
+
+using namespace Midi;
+
+/// @brief keeps every write, and the size of the largest one
+template <size_t BufferLength>
+class WireSink : public EncodingMidiSink<BufferLength, 4>
+{
+public:
+  uint8_t wire[256];
+  size_t length = 0;
+  size_t writes = 0;
+  size_t largest = 0;
+
+  virtual void start() override {}
+  virtual void stop() override {}
+  virtual bool isConnected() override { return true; }
+
+protected:
+  virtual void write(const uint8_t *data, size_t count) override
+  {
+    memcpy(wire + length, data, count);
+    length += count;
+    writes++;
+    largest = count > largest ? count : largest;
+  }
+};
+
+void setUp() {}
+void tearDown() {}
+
+void test_realtime_goes_ahead_of_the_span()
+{
+  const MidiEvent events[] = {
+      MidiEvent::make(MidiMessageStatus::NoteOn, 0, 60, 100),
+      MidiEvent::make(0xF8, 0, 0, 0),
+      MidiEvent::make(MidiMessageStatus::NoteOn, 0, 64, 100),
+      MidiEvent::make(0xFA, 0, 0, 0),
+      MidiEvent::make(MidiMessageStatus::ControlChange, 0, 7, 90)};
+  MidiStreamEncoder encoder;
+  uint8_t bytes[16];
+  size_t consumed = 0;
+  const size_t length = encoder.encode(events, 5, bytes, sizeof(bytes), consumed);
+  // the clock does not break the running status of the notes
+  const uint8_t expected[] = {0xF8, 0xFA, 0x90, 60, 100, 64, 100, 0xB0, 7, 90};
+  TEST_ASSERT_EQUAL(5, consumed);
+  TEST_ASSERT_EQUAL(sizeof(expected), length);
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, bytes, sizeof(expected));
+}
+
+void test_only_the_fitting_prefix_is_written()
+{
+  const MidiEvent events[] = {
+      MidiEvent::make(MidiMessageStatus::NoteOn, 0, 60, 100),
+      MidiEvent::make(MidiMessageStatus::NoteOn, 0, 64, 100),
+      MidiEvent::make(0xF8, 0, 0, 0),
+      MidiEvent::make(MidiMessageStatus::NoteOn, 1, 67, 100)};
+  MidiStreamEncoder encoder;
+  uint8_t bytes[16];
+  size_t consumed = 0;
+  // room for the two notes and the clock, not for the note on the other channel
+  size_t length = encoder.encode(events, 4, bytes, 7, consumed);
+  TEST_ASSERT_EQUAL(3, consumed);
+  TEST_ASSERT_EQUAL(6, length);
+  TEST_ASSERT_EQUAL_HEX8(0xF8, bytes[0]);
+
+  // the rest follows in the next call, running status carried over
+  length = encoder.encode(events + 3, 1, bytes, sizeof(bytes), consumed);
+  TEST_ASSERT_EQUAL(1, consumed);
+  TEST_ASSERT_EQUAL(3, length);
+  TEST_ASSERT_EQUAL_HEX8(0x91, bytes[0]);
+  encoder.resetRunningStatus();
+  length = encoder.encode(events + 3, 1, bytes, sizeof(bytes), consumed);
+  TEST_ASSERT_EQUAL(3, length);
+}
+
+void test_sink_splits_sysex_to_its_buffer()
+{
+  uint8_t payload[20];
+  for (size_t i = 0; i < sizeof(payload); i++)
+  {
+    payload[i] = (uint8_t)i;
+  }
+  static WireSink<8> sink;
+  // a queued note goes out before the dump
+  sink.send(MidiEvent::make(MidiMessageStatus::NoteOn, 0, 60, 100));
+  SysExChunk chunk = {payload, sizeof(payload), 0, true, true, false};
+  sink.sendSysEx(chunk);
+
+  TEST_ASSERT_EQUAL(3 + 1 + sizeof(payload) + 1, sink.length);
+  TEST_ASSERT_TRUE(sink.largest <= 8);
+  TEST_ASSERT_EQUAL(5, sink.writes);
+  TEST_ASSERT_EQUAL_HEX8(0x90, sink.wire[0]);
+  TEST_ASSERT_EQUAL_HEX8(0xF0, sink.wire[3]);
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(payload, sink.wire + 4, sizeof(payload));
+  TEST_ASSERT_EQUAL_HEX8(0xF7, sink.wire[sink.length - 1]);
+}
+
+void test_sysex_chunks_keep_their_framing()
+{
+  const uint8_t payload[] = {0x41, 0x10, 0x42};
+  static WireSink<16> sink;
+  // the middle of a dump has neither F0 nor F7, an aborted one gets no F7
+  SysExChunk middle = {payload, 3, 0, false, false, false};
+  sink.sendSysEx(middle);
+  SysExChunk aborted = {payload, 3, 0, false, true, true};
+  sink.sendSysEx(aborted);
+  TEST_ASSERT_EQUAL(6, sink.length);
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(payload, sink.wire, 3);
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(payload, sink.wire + 3, 3);
+
+  // SysEx cancels running status on the wire
+  sink.send(MidiEvent::make(MidiMessageStatus::NoteOn, 0, 60, 100));
+  sink.flush();
+  SysExChunk whole = {payload, 3, 0, true, true, false};
+  sink.sendSysEx(whole);
+  sink.send(MidiEvent::make(MidiMessageStatus::NoteOn, 0, 62, 100));
+  sink.flush();
+  TEST_ASSERT_EQUAL(6 + 3 + 5 + 3, sink.length);
+  TEST_ASSERT_EQUAL_HEX8(0x90, sink.wire[sink.length - 3]);
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_realtime_goes_ahead_of_the_span);
+  RUN_TEST(test_only_the_fitting_prefix_is_written);
+  RUN_TEST(test_sink_splits_sysex_to_its_buffer);
+  RUN_TEST(test_sysex_chunks_keep_their_framing);
+  return UNITY_END();
+}
@@ -0,0 +1,231 @@
+#include <unity.h>
+#include <stdint.h>
+#include <cstddef>
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+#include "../../lib/Midi/MidiStreamParser.h"
+#include "../../lib/Midi/MidiStreamEncoder.h"
+
+using namespace Midi;
+
+/// @brief collects everything the parser hands over
+struct Collector
+{
+  MidiEvent events[1024];
+  size_t count;
+  uint8_t sysEx[256];
+  size_t sysExLength;
+  size_t sysExChunks;
+  bool sysExFirst;
+  bool sysExLast;
+
+  Collector() : count(0), sysExLength(0), sysExChunks(0), sysExFirst(false), sysExLast(false) {}
+
+  void onEvents(const MidiEvent *batch, size_t length)
+  {
+    for (size_t i = 0; i < length && count < 1024; i++)
+    {
+      events[count++] = batch[i];
+    }
+  }
+  void onSysEx(const SysExChunk &chunk)
+  {
+    if (sysExChunks == 0)
+    {
+      sysExFirst = chunk.first;
+    }
+    sysExLast = chunk.last;
+    memcpy(sysEx + sysExLength, chunk.data, chunk.length);
+    sysExLength += chunk.length;
+    sysExChunks++;
+  }
+};
+
+/// @brief only counts, keeps the throughput measurement free of copies
+struct Counter
+{
+  size_t count = 0;
+  void onEvents(const MidiEvent *batch, size_t length) { count += length; }
+  void onSysEx(const SysExChunk &chunk) {}
+};
+
+static uint32_t seed;
+static uint32_t nextRandom()
+{
+  seed = seed * 1664525u + 1013904223u;
+  return seed >> 8;
+}
+
+/// @brief channel and system common messages with valid data bytes, no SysEx or realtime
+static MidiEvent randomEvent()
+{
+  static const MidiMessageStatus channelTypes[7] = {
+      MidiMessageStatus::NoteOff, MidiMessageStatus::NoteOn, MidiMessageStatus::PolyphonicKeyPressure,
+      MidiMessageStatus::ControlChange, MidiMessageStatus::ProgramChange, MidiMessageStatus::ChannelPressure,
+      MidiMessageStatus::PitchBendChange};
+  static const MidiMessageStatus systemTypes[4] = {
+      MidiMessageStatus::TimeCodeQuarterFrame, MidiMessageStatus::SongPositionPointer,
+      MidiMessageStatus::SongSelect, MidiMessageStatus::TuneRequest};
+  const uint32_t r = nextRandom();
+  // mostly notes and controllers on few channels, so running status gets exercised
+  const MidiMessageStatus type = (r % 16) == 0 ? systemTypes[(r >> 4) % 4] : channelTypes[(r >> 4) % 7];
+  return MidiEvent::make(type, (uint8_t)((r >> 8) % 3), (uint8_t)(r >> 12), (uint8_t)(r >> 19));
+}
+
+static bool sameEvent(const MidiEvent &a, const MidiEvent &b)
+{
+  return a.status == b.status && a.length == b.length &&
+         (a.length < 1 || a.data1 == b.data1) && (a.length < 2 || a.data2 == b.data2);
+}
+
+void setUp() { seed = 12345; }
+void tearDown() {}
+
+void test_round_trip_in_random_chunks()
+{
+  MidiEvent sent[512];
+  for (size_t i = 0; i < 512; i++)
+  {
+    sent[i] = randomEvent();
+  }
+  MidiStreamEncoder encoder;
+  uint8_t bytes[512 * 3];
+  size_t consumed = 0;
+  const size_t length = encoder.encode(sent, 512, bytes, sizeof(bytes), consumed);
+  TEST_ASSERT_EQUAL(512, consumed);
+  // running status has to save bytes on this stream
+  TEST_ASSERT_LESS_THAN(512 * 3, length);
+
+  MidiStreamParser<8> parser;
+  Collector collector;
+  size_t offset = 0;
+  while (offset < length)
+  {
+    size_t chunk = 1 + nextRandom() % 7;
+    chunk = chunk > length - offset ? length - offset : chunk;
+    parser.parse(bytes + offset, chunk, collector);
+    offset += chunk;
+  }
+  TEST_ASSERT_EQUAL(512, collector.count);
+  for (size_t i = 0; i < 512; i++)
+  {
+    TEST_ASSERT_TRUE(sameEvent(sent[i], collector.events[i]));
+  }
+  TEST_ASSERT_EQUAL(0, parser.droppedBytes());
+}
+
+void test_note_off_as_note_on_round_trip()
+{
+  MidiEvent sent[2] = {
+      MidiEvent::make(MidiMessageStatus::NoteOn, 3, 60, 100),
+      MidiEvent::make(MidiMessageStatus::NoteOff, 3, 60, 64)};
+  MidiStreamEncoder encoder;
+  encoder.setNoteOffAsNoteOn(true);
+  uint8_t bytes[6];
+  size_t consumed = 0;
+  const size_t length = encoder.encode(sent, 2, bytes, sizeof(bytes), consumed);
+  const uint8_t expected[5] = {0x93, 60, 100, 60, 0};
+  TEST_ASSERT_EQUAL(5, length);
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, bytes, 5);
+
+  MidiStreamParser<> parser;
+  Collector collector;
+  parser.parse(bytes, length, collector);
+  TEST_ASSERT_EQUAL(2, collector.count);
+  TEST_ASSERT_EQUAL_HEX8(0x93, collector.events[1].status);
+  TEST_ASSERT_EQUAL(0, collector.events[1].data2);
+}
+
+void test_realtime_inside_a_message()
+{
+  const uint8_t bytes[] = {0x90, 0x3C, 0xF8, 0x64, 0x3E, 0xFE, 0x50};
+  MidiStreamParser<> parser;
+  Collector collector;
+  parser.parse(bytes, sizeof(bytes), collector);
+  TEST_ASSERT_EQUAL(4, collector.count);
+  TEST_ASSERT_EQUAL_HEX8(0xF8, collector.events[0].status);
+  TEST_ASSERT_EQUAL_HEX8(0x90, collector.events[1].status);
+  TEST_ASSERT_EQUAL(0x3C, collector.events[1].data1);
+  TEST_ASSERT_EQUAL(0x64, collector.events[1].data2);
+  TEST_ASSERT_EQUAL_HEX8(0xFE, collector.events[2].status);
+  // running status survives the realtime byte
+  TEST_ASSERT_EQUAL_HEX8(0x90, collector.events[3].status);
+  TEST_ASSERT_EQUAL(0x3E, collector.events[3].data1);
+}
+
+void test_sysex_across_chunks()
+{
+  const uint8_t first[] = {0xF0, 0x7E, 0x01, 0x02};
+  const uint8_t second[] = {0x03, 0xF8, 0x04, 0xF7, 0xC1, 0x05};
+  MidiStreamParser<> parser;
+  Collector collector;
+  parser.parse(first, sizeof(first), collector);
+  TEST_ASSERT_TRUE(parser.inSysEx());
+  parser.parse(second, sizeof(second), collector);
+  TEST_ASSERT_FALSE(parser.inSysEx());
+
+  const uint8_t payload[] = {0x7E, 0x01, 0x02, 0x03, 0x04};
+  TEST_ASSERT_EQUAL(sizeof(payload), collector.sysExLength);
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(payload, collector.sysEx, sizeof(payload));
+  TEST_ASSERT_TRUE(collector.sysExFirst);
+  TEST_ASSERT_TRUE(collector.sysExLast);
+  TEST_ASSERT_EQUAL(2, collector.count);
+  TEST_ASSERT_EQUAL_HEX8(0xF8, collector.events[0].status);
+  TEST_ASSERT_EQUAL_HEX8(0xC1, collector.events[1].status);
+  TEST_ASSERT_EQUAL(0x05, collector.events[1].data1);
+}
+
+void test_data_without_status_is_dropped()
+{
+  const uint8_t bytes[] = {0x40, 0x41, 0xB0, 0x07, 0x64, 0xF6, 0x10};
+  MidiStreamParser<> parser;
+  Collector collector;
+  parser.parse(bytes, sizeof(bytes), collector);
+  TEST_ASSERT_EQUAL(2, collector.count);
+  TEST_ASSERT_EQUAL_HEX8(0xB0, collector.events[0].status);
+  TEST_ASSERT_EQUAL_HEX8(0xF6, collector.events[1].status);
+  // tune request cancels running status, the last byte has nothing to attach to
+  TEST_ASSERT_EQUAL(3, parser.droppedBytes());
+}
+
+/// @brief reports the host parse rate of controller traffic, not an assertion since it depends on the machine
+void test_throughput()
+{
+  static uint8_t bytes[64 * 1024];
+  size_t length = 0;
+  while (length + 2 <= sizeof(bytes))
+  {
+    if (length == 0)
+    {
+      bytes[length++] = 0xB0;
+    }
+    bytes[length++] = 0x07;
+    bytes[length++] = (uint8_t)(nextRandom() & 0x7F);
+  }
+  MidiStreamParser<> parser;
+  Counter counter;
+  const int rounds = 200;
+  const auto start = std::chrono::steady_clock::now();
+  for (int r = 0; r < rounds; r++)
+  {
+    parser.parse(bytes, length, counter);
+  }
+  const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  TEST_ASSERT_EQUAL((length / 2) * rounds, counter.count);
+  char message[64];
+  snprintf(message, sizeof(message), "%.0f MB/s", (double)length * rounds / seconds / 1e6);
+  TEST_MESSAGE(message);
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_round_trip_in_random_chunks);
+  RUN_TEST(test_note_off_as_note_on_round_trip);
+  RUN_TEST(test_realtime_inside_a_message);
+  RUN_TEST(test_sysex_across_chunks);
+  RUN_TEST(test_data_without_status_is_dropped);
+  RUN_TEST(test_throughput);
+  return UNITY_END();
+}
@@ -0,0 +1,119 @@
+#include <unity.h>
+#include <stdint.h>
+#include <cstddef>
+#include <math.h>
+#include "../../lib/Synthesis/PhaseVocoder.h"
+
+using namespace Synthesis;
+
+static const float SampleRate = 44100.0f;
+static PhaseVocoder<48, 1024> vocoder;
+
+/*
+ * shifts a sine of amplitude 0.5 (0.354 RMS), returns the output RMS after the latency,
+ * crossings counts the upward zero crossings of the measured part
+ */
+static float shiftedRms(float frequency, float ratio, size_t &crossings)
+{
+    vocoder.reset();
+    vocoder.setPitch(ratio);
+    StaticSampleBuffer<48> in, out;
+    const size_t blocks = 2 * (size_t)SampleRate / 48;
+    const size_t settle = 2 * 1024 / 48 + 1;
+    float phase = 0.0f;
+    float sum = 0.0f;
+    size_t count = 0;
+    float last = 0.0f;
+    crossings = 0;
+    for (size_t b = 0; b < blocks; b++)
+    {
+        for (size_t n = 0; n < 48; n++)
+        {
+            in[n] = 0.5f * sinf(phase);
+            phase += 2.0f * (float)M_PI * frequency / SampleRate;
+            if (phase > 2.0f * (float)M_PI)
+            {
+                phase -= 2.0f * (float)M_PI;
+            }
+        }
+        vocoder.process(in, out);
+        if (b < settle)
+        {
+            continue;
+        }
+        for (size_t n = 0; n < 48; n++)
+        {
+            sum += out[n] * out[n];
+            if (last < 0.0f && out[n] >= 0.0f)
+            {
+                crossings++;
+            }
+            last = out[n];
+            count++;
+        }
+    }
+    return sqrtf(sum / (float)count);
+}
+
+static void checkShift(float frequency, float ratio)
+{
+    size_t crossings = 0;
+    const float rms = shiftedRms(frequency, ratio, crossings);
+    const float seconds = (2.0f * SampleRate - (2.0f * 1024.0f / 48.0f + 1.0f) * 48.0f) / SampleRate;
+    // within 1.5 dB of the input level (0.354)
+    TEST_ASSERT_TRUE(rms > 0.3f);
+    TEST_ASSERT_TRUE(rms < 0.42f);
+    // and at the shifted frequency, within 3 %
+    const float measured = (float)crossings / seconds;
+    TEST_ASSERT_TRUE(fabsf(measured - frequency * ratio) < 0.03f * frequency * ratio);
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_identity_keeps_the_level()
+{
+    checkShift(441.0f, 1.0f);
+}
+
+void test_upward_shifts_keep_the_level()
+{
+    checkShift(441.0f, 2.0f);
+    checkShift(1000.0f, 1.2f);
+    checkShift(1000.0f, 1.5f);
+    checkShift(220.0f, 1.5f);
+    checkShift(110.0f, 3.0f);
+}
+
+void test_downward_shifts_keep_the_level()
+{
+    checkShift(441.0f, 0.5f);
+    checkShift(1000.0f, 0.75f);
+    checkShift(880.0f, 0.8f);
+    checkShift(3000.0f, 0.3f);
+}
+
+void test_invalid_settings_are_rejected()
+{
+    TEST_ASSERT_FALSE(vocoder.configure(1000, 250));
+    TEST_ASSERT_FALSE(vocoder.configure(2048, 512));
+    TEST_ASSERT_EQUAL(1023, vocoder.latency());
+    TEST_ASSERT_TRUE(vocoder.configure(256, 64));
+    TEST_ASSERT_EQUAL(255, vocoder.latency());
+    TEST_ASSERT_TRUE(vocoder.configure(1024, 256));
+
+    // a negative ratio is limited instead of indexing outside the spectrum
+    size_t crossings = 0;
+    const float rms = shiftedRms(441.0f, -2.0f, crossings);
+    TEST_ASSERT_TRUE(rms < 0.5f);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_identity_keeps_the_level);
+    RUN_TEST(test_upward_shifts_keep_the_level);
+    RUN_TEST(test_downward_shifts_keep_the_level);
+    RUN_TEST(test_invalid_settings_are_rejected);
+    return UNITY_END();
+}
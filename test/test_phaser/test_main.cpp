@@ -0,0 +1,150 @@
+#include <unity.h>
+#include <stdint.h>
+#include <cstddef>
+#include <math.h>
+#include "../../lib/Synthesis/Phaser.h"
+
+using namespace Synthesis;
+
+static const float SampleRate = 44100.0f;
+static const size_t BlockLength = 48;
+
+static StaticSampleBuffer<BlockLength> input;
+static StaticSampleBuffer<BlockLength> output;
+
+/*
+ * peak output level of a unit sine over the second half of half a second
+ */
+static float level(Phaser<BlockLength> &phaser, float frequency)
+{
+    phaser.reset();
+    const size_t blocks = (size_t)(0.5f * SampleRate) / BlockLength;
+    float peak = 0.0f;
+    for (size_t b = 0; b < blocks; b++)
+    {
+        for (size_t n = 0; n < BlockLength; n++)
+        {
+            input[n] = sinf(2.0f * M_PI * frequency * (float)(b * BlockLength + n) / SampleRate);
+        }
+        phaser.process(input, output);
+        for (size_t n = 0; b >= blocks / 2 && n < BlockLength; n++)
+        {
+            peak = fmaxf(peak, fabsf(output[n]));
+        }
+    }
+    return peak;
+}
+
+/*
+ * a first-order stage shifts by -2 atan(tan(pi f / fs) / tan(pi fc / fs)), the cascade notches where
+ * the stages sum to an odd multiple of -180 degrees
+ */
+static float notchFrequency(size_t stages, size_t notch)
+{
+    const float center = sqrtf(200.0f * 2000.0f);
+    const float stagePhase = (float)(2 * notch + 1) * M_PI / (float)stages;
+    return SampleRate / M_PI * atanf(tanf(M_PI * center / SampleRate) * tanf(0.5f * stagePhase));
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_four_stages_notch_around_the_break_frequency()
+{
+    static Phaser<BlockLength> phaser(SampleRate);
+    // a still LFO sits in the middle of the range, sqrt(200 * 2000) Hz
+    phaser.setRate(0.0f);
+    TEST_ASSERT_TRUE(level(phaser, notchFrequency(4, 0)) < 0.02f);
+    TEST_ASSERT_TRUE(level(phaser, notchFrequency(4, 1)) < 0.02f);
+    // at the break frequency and far from it the wet signal is back in phase
+    TEST_ASSERT_TRUE(level(phaser, sqrtf(200.0f * 2000.0f)) > 0.95f);
+    TEST_ASSERT_TRUE(level(phaser, 30.0f) > 0.9f);
+    TEST_ASSERT_TRUE(level(phaser, 15000.0f) > 0.9f);
+}
+
+void test_each_pair_of_stages_adds_a_notch()
+{
+    static Phaser<BlockLength> phaser(SampleRate);
+    phaser.setRate(0.0f);
+    phaser.setStages(8);
+    for (size_t notch = 0; notch < 4; notch++)
+    {
+        TEST_ASSERT_TRUE(level(phaser, notchFrequency(8, notch)) < 0.02f);
+    }
+    // odd counts are rounded down
+    phaser.setStages(7);
+    TEST_ASSERT_EQUAL(6, phaser.stages());
+}
+
+void test_the_sweep_moves_the_notch()
+{
+    static Phaser<BlockLength> phaser(SampleRate);
+    phaser.setRate(2.0f);
+    const float tone = sqrtf(200.0f * 2000.0f);
+    const size_t blocks = (size_t)SampleRate / BlockLength;
+    float lowest = 1.0f;
+    float highest = 0.0f;
+    for (size_t b = 0; b < blocks; b++)
+    {
+        for (size_t n = 0; n < BlockLength; n++)
+        {
+            input[n] = sinf(2.0f * M_PI * tone * (float)(b * BlockLength + n) / SampleRate);
+        }
+        phaser.process(input, output);
+        // envelope per block, ten cycles of the tone
+        if (b % 10 == 9)
+        {
+            float peak = 0.0f;
+            for (size_t n = 0; n < BlockLength; n++)
+            {
+                peak = fmaxf(peak, fabsf(output[n]));
+            }
+            lowest = fminf(lowest, peak);
+            highest = fmaxf(highest, peak);
+        }
+    }
+    TEST_ASSERT_TRUE(lowest < 0.2f);
+    TEST_ASSERT_TRUE(highest > 0.8f);
+}
+
+void test_stereo_phaser_matches_mono_and_offsets_the_right_channel()
+{
+    static Phaser<BlockLength> mono(SampleRate);
+    static StereoPhaser<BlockLength> stereo(SampleRate);
+    static StaticStereoSampleBuffer<BlockLength> signal;
+    mono.setRate(1.0f);
+    stereo.setRate(1.0f);
+
+    float leftError = 0.0f;
+    float rightDifference = 0.0f;
+    const size_t blocks = (size_t)SampleRate / BlockLength;
+    for (size_t b = 0; b < blocks; b++)
+    {
+        for (size_t n = 0; n < BlockLength; n++)
+        {
+            const float x = sinf(2.0f * M_PI * 632.0f * (float)(b * BlockLength + n) / SampleRate);
+            input[n] = x;
+            signal.left()[n] = x;
+            signal.right()[n] = x;
+        }
+        mono.process(input, output);
+        stereo.processInplace(signal);
+        for (size_t n = 0; n < BlockLength; n++)
+        {
+            leftError = fmaxf(leftError, fabsf(signal.left()[n] - output[n]));
+            rightDifference = fmaxf(rightDifference, fabsf(signal.right()[n] - output[n]));
+        }
+    }
+    TEST_ASSERT_TRUE(leftError < 1e-5f);
+    TEST_ASSERT_TRUE(rightDifference > 0.3f);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_four_stages_notch_around_the_break_frequency);
+    RUN_TEST(test_each_pair_of_stages_adds_a_notch);
+    RUN_TEST(test_the_sweep_moves_the_notch);
+    RUN_TEST(test_stereo_phaser_matches_mono_and_offsets_the_right_channel);
+    return UNITY_END();
+}
@@ -0,0 +1,170 @@
+#include <unity.h>
+#include <stdint.h>
+#include <cstddef>
+#include <math.h>
+#include "../../lib/Synthesis/RotarySpeaker.h"
+
+using namespace Synthesis;
+
+static const float SampleRate = 44100.0f;
+static const size_t BlockLength = 48;
+
+static StaticSampleBuffer<BlockLength> input;
+static StaticSampleBuffer<BlockLength> output;
+static StaticStereoSampleBuffer<BlockLength> stereo;
+static size_t position = 0;
+
+/*
+ * renders a sine for the given time, returns the lowest and highest 10 ms RMS level of the left channel
+ * after the first 100 ms
+ */
+static void render(RotarySpeaker<BlockLength> &speaker, float frequency, float seconds, float &lowest, float &highest)
+{
+    const size_t window = (size_t)(0.01f * SampleRate) / BlockLength;
+    const size_t settle = (size_t)(0.1f * SampleRate) / BlockLength;
+    const size_t blocks = (size_t)(seconds * SampleRate) / BlockLength;
+    float energy = 0.0f;
+    lowest = 1e9f;
+    highest = 0.0f;
+    for (size_t b = 0; b < blocks; b++)
+    {
+        for (size_t n = 0; n < BlockLength; n++)
+        {
+            input[n] = sinf(2.0f * M_PI * frequency * (float)position++ / SampleRate);
+        }
+        speaker.processStereo(input, stereo);
+        for (size_t n = 0; n < BlockLength; n++)
+        {
+            energy += stereo.left()[n] * stereo.left()[n];
+        }
+        if (b % window == window - 1)
+        {
+            const float rms = sqrtf(energy / (float)(window * BlockLength));
+            if (b >= settle)
+            {
+                lowest = fminf(lowest, rms);
+                highest = fmaxf(highest, rms);
+            }
+            energy = 0.0f;
+        }
+    }
+}
+
+static void run(RotarySpeaker<BlockLength> &speaker, float seconds)
+{
+    float lowest, highest;
+    render(speaker, 440.0f, seconds, lowest, highest);
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_rotors_spin_up_and_slow_down_at_their_own_rate()
+{
+    static RotarySpeaker<BlockLength> speaker(SampleRate);
+    TEST_ASSERT_TRUE(fabsf(speaker.hornSpeed() - 0.83f) < 1e-6f);
+    TEST_ASSERT_TRUE(fabsf(speaker.drumSpeed() - 0.70f) < 1e-6f);
+
+    // modulation wheel up: the horn covers about 63 % of the change in 0.7 s, the drum much less
+    speaker.controlChange(1, 127);
+    run(speaker, 0.7f);
+    TEST_ASSERT_TRUE(fabsf(speaker.hornSpeed() - (0.83f + 0.632f * (6.75f - 0.83f))) < 0.2f);
+    TEST_ASSERT_TRUE(speaker.drumSpeed() < 0.70f + 0.2f * (5.90f - 0.70f));
+    run(speaker, 30.0f);
+    TEST_ASSERT_TRUE(fabsf(speaker.hornSpeed() - 6.75f) < 0.01f);
+    TEST_ASSERT_TRUE(fabsf(speaker.drumSpeed() - 5.90f) < 0.01f);
+
+    // the brake stops both rotors and wins over the speed control
+    speaker.controlChange(66, 127);
+    speaker.controlChange(1, 127);
+    run(speaker, 40.0f);
+    TEST_ASSERT_TRUE(speaker.hornSpeed() < 0.01f);
+    TEST_ASSERT_TRUE(speaker.drumSpeed() < 0.01f);
+
+    // released brake with the wheel down returns to chorale
+    speaker.controlChange(66, 0);
+    speaker.controlChange(1, 0);
+    run(speaker, 30.0f);
+    TEST_ASSERT_TRUE(fabsf(speaker.hornSpeed() - 0.83f) < 0.01f);
+}
+
+void test_controls_can_be_moved()
+{
+    static RotarySpeaker<BlockLength> speaker(SampleRate);
+    speaker.setControls(64, 67);
+    speaker.controlChange(1, 127);
+    TEST_ASSERT_TRUE(fabsf(speaker.hornSpeed() - 0.83f) < 1e-6f);
+    speaker.controlChange(64, 127);
+    run(speaker, 30.0f);
+    TEST_ASSERT_TRUE(fabsf(speaker.hornSpeed() - 6.75f) < 0.01f);
+}
+
+void test_spinning_horn_modulates_and_a_stopped_one_does_not()
+{
+    static RotarySpeaker<BlockLength> speaker(SampleRate);
+    float lowest, highest;
+    // a treble tone goes to the horn
+    speaker.setSpeed(RotarySpeed::tremolo);
+    run(speaker, 30.0f);
+    render(speaker, 3000.0f, 1.0f, lowest, highest);
+    TEST_ASSERT_TRUE(highest > 1.2f * lowest);
+
+    speaker.setBrake(true);
+    run(speaker, 30.0f);
+    render(speaker, 3000.0f, 1.0f, lowest, highest);
+    TEST_ASSERT_TRUE(highest < 1.02f * lowest);
+}
+
+void test_crossover_splits_between_drum_and_horn()
+{
+    static RotarySpeaker<BlockLength> speaker(SampleRate);
+    float lowest, highest;
+    // horn only: the bass tone is mostly gone, the treble tone passes
+    speaker.setLevels(1.0f, 0.0f);
+    render(speaker, 50.0f, 0.5f, lowest, highest);
+    TEST_ASSERT_TRUE(highest < 0.1f);
+    render(speaker, 5000.0f, 0.5f, lowest, highest);
+    TEST_ASSERT_TRUE(lowest > 0.3f);
+
+    // drum only: the other way around
+    speaker.setLevels(0.0f, 1.0f);
+    render(speaker, 50.0f, 0.5f, lowest, highest);
+    TEST_ASSERT_TRUE(lowest > 0.3f);
+    render(speaker, 5000.0f, 0.5f, lowest, highest);
+    TEST_ASSERT_TRUE(highest < 0.1f);
+}
+
+void test_microphones_hear_different_signals_and_mono_is_their_mean()
+{
+    static RotarySpeaker<BlockLength> speaker(SampleRate);
+    static RotarySpeaker<BlockLength> mono(SampleRate);
+    float difference = 0.0f;
+    float meanError = 0.0f;
+    for (size_t b = 0; b < (size_t)SampleRate / BlockLength; b++)
+    {
+        for (size_t n = 0; n < BlockLength; n++)
+        {
+            input[n] = sinf(2.0f * M_PI * 2000.0f * (float)(b * BlockLength + n) / SampleRate);
+        }
+        speaker.processStereo(input, stereo);
+        mono.process(input, output);
+        for (size_t n = 0; n < BlockLength; n++)
+        {
+            difference = fmaxf(difference, fabsf(stereo.left()[n] - stereo.right()[n]));
+            meanError = fmaxf(meanError, fabsf(output[n] - 0.5f * (stereo.left()[n] + stereo.right()[n])));
+        }
+    }
+    TEST_ASSERT_TRUE(difference > 0.1f);
+    TEST_ASSERT_TRUE(meanError < 1e-6f);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_rotors_spin_up_and_slow_down_at_their_own_rate);
+    RUN_TEST(test_controls_can_be_moved);
+    RUN_TEST(test_spinning_horn_modulates_and_a_stopped_one_does_not);
+    RUN_TEST(test_crossover_splits_between_drum_and_horn);
+    RUN_TEST(test_microphones_hear_different_signals_and_mono_is_their_mean);
+    return UNITY_END();
+}
@@ -0,0 +1,219 @@
+#include <unity.h>
+#include <stdint.h>
+#include <cstddef>
+#include "../../src/Synth/VoiceAllocator.h"
+#include "../../src/Synth/Synth.h"
+
+typedef VoiceAllocator<8> Allocator;
+
+static float left[SAMPLE_BUFFER_SIZE];
+static float right[SAMPLE_BUFFER_SIZE];
+
+/*
+ * renders until the engine idles, returns false if it is still busy after a minute of audio
+ */
+template <class Engine>
+static bool renderUntilIdle(Engine &synth)
+{
+    const size_t limit = 60 * SAMPLE_RATE / SAMPLE_BUFFER_SIZE;
+    for (size_t b = 0; b < limit && !synth.isIdle(); b++)
+    {
+        synth.render(left, right);
+    }
+    return synth.isIdle();
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_repeated_note_on_releases_the_held_voice()
+{
+    Allocator allocator;
+    const Allocator::Allocation first = allocator.noteOn(0, 60);
+    const Allocator::Allocation second = allocator.noteOn(0, 60);
+    TEST_ASSERT_TRUE(first.voice != second.voice);
+    TEST_ASSERT_EQUAL(first.voice, second.released);
+    TEST_ASSERT_TRUE(allocator.state(first.voice) == VoiceState::releasing);
+
+    TEST_ASSERT_EQUAL(second.voice, allocator.noteOff(0, 60));
+    // nothing left for a second NoteOff to release
+    TEST_ASSERT_EQUAL(Allocator::NoVoice, allocator.noteOff(0, 60));
+    allocator.voiceEnded(first.voice);
+    allocator.voiceEnded(second.voice);
+    TEST_ASSERT_EQUAL(0, allocator.activeCount());
+    TEST_ASSERT_EQUAL(0, allocator.channelCount(0));
+}
+
+void test_same_note_takes_back_a_releasing_voice()
+{
+    Allocator allocator;
+    allocator.setPolicy(0, StealPolicy::sameNote);
+    const Allocator::Allocation first = allocator.noteOn(0, 60);
+    allocator.noteOff(0, 60);
+    const Allocator::Allocation again = allocator.noteOn(0, 60);
+    TEST_ASSERT_EQUAL(first.voice, again.voice);
+    TEST_ASSERT_TRUE(again.retrigger);
+    TEST_ASSERT_TRUE(allocator.notes().isHeld(0, 60));
+    TEST_ASSERT_EQUAL(first.voice, allocator.noteOff(0, 60));
+
+    allocator.voiceEnded(first.voice);
+    const Allocator::Allocation fresh = allocator.noteOn(0, 60);
+    TEST_ASSERT_FALSE(fresh.retrigger);
+}
+
+void test_stealing_keeps_the_books_balanced()
+{
+    Allocator allocator;
+    allocator.setFadeLength(0);
+    for (uint8_t n = 0; n < 40; n++)
+    {
+        allocator.noteOn(n % 3, (uint8_t)(40 + n % 12));
+    }
+    TEST_ASSERT_EQUAL(8, allocator.activeCount());
+    size_t held = 0;
+    for (uint8_t c = 0; c < 3; c++)
+    {
+        held += allocator.channelCount(c);
+    }
+    TEST_ASSERT_EQUAL(8, held);
+}
+
+void test_quietest_is_found_again_after_a_steal()
+{
+    Allocator allocator;
+    const float levels[4] = {0.9f, 0.2f, 0.5f, 0.1f};
+    uint8_t voices[4];
+    for (uint8_t i = 0; i < 4; i++)
+    {
+        voices[i] = allocator.noteOn(0, (uint8_t)(60 + i)).voice;
+    }
+    for (uint8_t i = 0; i < 4; i++)
+    {
+        allocator.setLevel(voices[i], levels[i]);
+    }
+    TEST_ASSERT_EQUAL(voices[3], allocator.stealOne(StealPolicy::quietest));
+    // the next quietest, not the oldest
+    TEST_ASSERT_EQUAL(voices[1], allocator.stealOne(StealPolicy::quietest));
+    TEST_ASSERT_EQUAL(voices[2], allocator.stealOne(StealPolicy::quietest));
+
+    // a voice that got louder again leaves its low bucket
+    const uint8_t fresh = allocator.noteOn(0, 70).voice;
+    allocator.setLevel(voices[0], 0.05f);
+    allocator.setLevel(fresh, 0.02f);
+    allocator.setLevel(voices[0], 0.6f);
+    TEST_ASSERT_EQUAL(fresh, allocator.stealOne(StealPolicy::quietest));
+    TEST_ASSERT_EQUAL(voices[0], allocator.stealOne(StealPolicy::quietest));
+}
+
+void test_full_quota_and_limit_steal_one_voice()
+{
+    Allocator allocator;
+    allocator.setVoiceLimit(4);
+    allocator.setChannelQuota(0, 2);
+    const uint8_t own = allocator.noteOn(0, 60).voice;
+    allocator.noteOn(0, 61);
+    const uint8_t other = allocator.noteOn(1, 40).voice;
+    allocator.noteOn(1, 41);
+    TEST_ASSERT_EQUAL(4, allocator.activeCount());
+
+    // channel 0 is at its quota and the pool at its limit: only the channel's own oldest voice goes
+    const Allocator::Allocation allocation = allocator.noteOn(0, 62);
+    TEST_ASSERT_EQUAL(own, allocation.stolen);
+    TEST_ASSERT_EQUAL(1, allocator.steals());
+    TEST_ASSERT_EQUAL(4, allocator.activeCount());
+    TEST_ASSERT_EQUAL(2, allocator.channelCount(0));
+    TEST_ASSERT_EQUAL(2, allocator.channelCount(1));
+    TEST_ASSERT_TRUE(allocator.state(other) == VoiceState::playing);
+}
+
+void test_duplicate_note_on_then_note_off_goes_idle()
+{
+    static Synth<> synth;
+    synth.process(Midi::Messages::NoteOn(0, 60, 100));
+    synth.render(left, right);
+    synth.process(Midi::Messages::NoteOn(0, 60, 100));
+    synth.render(left, right);
+    synth.process(Midi::Messages::NoteOff(0, 60, 0));
+    TEST_ASSERT_TRUE(renderUntilIdle(synth));
+    TEST_ASSERT_EQUAL(0, synth.allocator().activeCount());
+}
+
+void test_all_notes_off_after_duplicates_goes_idle()
+{
+    static Synth<> synth;
+    for (uint8_t i = 0; i < 3; i++)
+    {
+        synth.process(Midi::Messages::NoteOn(1, 64, 90));
+        synth.process(Midi::Messages::NoteOn(1, 67, 90));
+        synth.render(left, right);
+    }
+    synth.process(Midi::Messages::ControlChange(1, 123, 0));
+    TEST_ASSERT_TRUE(renderUntilIdle(synth));
+}
+
+void test_note_storm_beyond_the_pool_goes_idle()
+{
+    static Synth<> synth;
+    for (uint8_t i = 0; i < 64; i++)
+    {
+        synth.process(Midi::Messages::NoteOn(i % 4, (uint8_t)(36 + (i * 7) % 48), 100));
+        if (i % 3 == 0)
+        {
+            synth.render(left, right);
+        }
+    }
+    for (uint8_t c = 0; c < 4; c++)
+    {
+        synth.process(Midi::Messages::ControlChange(c, 123, 0));
+    }
+    TEST_ASSERT_TRUE(renderUntilIdle(synth));
+    TEST_ASSERT_EQUAL(0, synth.voices().activeCount());
+}
+
+void test_scheduled_note_starts_on_its_sample()
+{
+    static Synth<> synth;
+    // idle blocks move the sample time on as well
+    TEST_ASSERT_FALSE(synth.render(left, right));
+    synth.skip();
+    TEST_ASSERT_EQUAL(2 * SAMPLE_BUFFER_SIZE, synth.sampleTime());
+
+    synth.schedule(Midi::MidiEvent::make(Midi::MidiMessageStatus::NoteOn, 0, 60, 100, synth.sampleTime() + 20));
+    TEST_ASSERT_FALSE(synth.isIdle());
+    TEST_ASSERT_TRUE(synth.render(left, right));
+    for (size_t n = 0; n <= 20; n++)
+    {
+        TEST_ASSERT_TRUE(left[n] == 0.0f);
+    }
+    TEST_ASSERT_TRUE(left[SAMPLE_BUFFER_SIZE - 1] != 0.0f);
+
+    // one block and a bit later
+    synth.schedule(Midi::MidiEvent::make(Midi::MidiMessageStatus::NoteOff, 0, 60, 0, synth.sampleTime() + SAMPLE_BUFFER_SIZE + 4));
+    synth.render(left, right);
+    TEST_ASSERT_FALSE(synth.voices().isReleasing(0));
+    synth.render(left, right);
+    TEST_ASSERT_TRUE(synth.voices().isReleasing(0));
+    TEST_ASSERT_TRUE(renderUntilIdle(synth));
+
+    // an event that is already due plays at the start of the next block
+    synth.schedule(Midi::MidiEvent::make(Midi::MidiMessageStatus::NoteOn, 0, 62, 100, synth.sampleTime() - 10));
+    TEST_ASSERT_TRUE(synth.render(left, right));
+    TEST_ASSERT_TRUE(left[1] != 0.0f);
+    synth.process(Midi::Messages::NoteOff(0, 62, 0));
+    TEST_ASSERT_TRUE(renderUntilIdle(synth));
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_repeated_note_on_releases_the_held_voice);
+    RUN_TEST(test_same_note_takes_back_a_releasing_voice);
+    RUN_TEST(test_stealing_keeps_the_books_balanced);
+    RUN_TEST(test_quietest_is_found_again_after_a_steal);
+    RUN_TEST(test_full_quota_and_limit_steal_one_voice);
+    RUN_TEST(test_duplicate_note_on_then_note_off_goes_idle);
+    RUN_TEST(test_all_notes_off_after_duplicates_goes_idle);
+    RUN_TEST(test_note_storm_beyond_the_pool_goes_idle);
+    RUN_TEST(test_scheduled_note_starts_on_its_sample);
+    return UNITY_END();
+}